@@ -0,0 +1,232 @@
+#include "BinaryImage.h"
+#include "ParallelExecutor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Conversion ----------------------------------------------------------------------------
+
+BinaryImage packBinaryImage(const ImageView& input, int threshold) {
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
+    }
+
+    int rows = input.height;
+    int cols = input.width;
+
+    BinaryImage image(cols, rows);
+
+    for (int i = 0; i < rows; ++i) {
+        const uint8_t* source = input.row(i);
+        uint64_t* destination = image.row(i);
+
+        for (int w = 0; w < image.wordsPerRow; ++w) {
+            int begin = w * 64;
+            int count = std::min(64, cols - begin);
+
+            uint64_t word = 0;
+            for (int b = 0; b < count; ++b) {
+                word |= static_cast<uint64_t>(source[begin + b] > threshold) << b;
+            }
+            destination[w] = word;
+        }
+    }
+
+    return image;
+}
+
+BinaryImage packBinaryImage(const ImageReadResult& inputImage, int threshold) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image metadata or missing buffer!");
+    }
+
+    return packBinaryImage(viewOf(inputImage), threshold);
+}
+
+std::vector<uint8_t> unpackBinaryImage(const BinaryImage& image) {
+    std::vector<uint8_t> outputBuffer(static_cast<size_t>(image.width) * image.height, 0);
+
+    for (int i = 0; i < image.height; ++i) {
+        const uint64_t* source = image.row(i);
+        uint8_t* destination = outputBuffer.data() + static_cast<size_t>(i) * image.width;
+
+        for (int j = 0; j < image.width; ++j) {
+            destination[j] = ((source[j / 64] >> (j % 64)) & 1) ? 255 : 0;
+        }
+    }
+
+    return outputBuffer;
+}
+
+bool isBinaryImage(const ImageView& input) {
+    if (!input.isValid()) {
+        return false;
+    }
+
+    for (int i = 0; i < input.height; ++i) {
+        const uint8_t* row = input.row(i);
+        if (!std::all_of(row, row + input.width, [](uint8_t value) { return value == 0 || value == 255; })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isBinaryImage(const ImageReadResult& inputImage) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        return false;
+    }
+
+    return isBinaryImage(viewOf(inputImage));
+}
+
+// Word-parallel morphology ---------------------------------------------------------------
+
+/* Erosion is an AND over the window and dilation an OR, and both are separable. Along a row we
+   combine whole words with shifted copies of themselves: after combining x with x shifted by 1, 2,
+   4, ... bit j holds the AND (OR) of a run starting at j that doubles each step, and one last
+   overlapping shift tops it up to the window length. That is O(log k) word operations per 64
+   pixels. Down the columns we combine whole word rows with the van Herk / Gil-Werman block
+   prefix/suffix scheme used by the grayscale version, so that pass is O(1) per word.
+
+   Pixels outside the image read as the identity of the operation (1 for AND, 0 for OR), matching
+   the "in-bounds pixels only" window of applyErosion / applyDilation. */
+
+static uint64_t tailMask(int width) {
+    // Bits of the last word of a row that lie past the image width
+    return (width % 64 == 0) ? 0 : ~((uint64_t(1) << (width % 64)) - 1);
+}
+
+// destination bit j = source bit (j + offset); anything outside the source row reads as fill
+static void shiftRow(const uint64_t* source, int sourceWords, uint64_t* destination, int destinationWords,
+                     int offset, uint64_t fill) {
+    int wordShift = (offset >= 0) ? offset / 64 : -((-offset + 63) / 64);
+    int bitShift = offset - wordShift * 64;
+
+    auto wordAt = [&](int index) -> uint64_t {
+        return (index >= 0 && index < sourceWords) ? source[index] : fill;
+    };
+
+    for (int w = 0; w < destinationWords; ++w) {
+        uint64_t low = wordAt(w + wordShift);
+        if (bitShift == 0) {
+            destination[w] = low;
+        } else {
+            uint64_t high = wordAt(w + wordShift + 1);
+            destination[w] = (low >> bitShift) | (high << (64 - bitShift));
+        }
+    }
+}
+
+template <typename Combine>
+static BinaryImage applyBinaryRankFilter(const BinaryImage& image, int kernelColumns, int kernelRows,
+                                         uint64_t fill, Combine combine) {
+    int rows = image.height;
+    int words = image.wordsPerRow;
+    int halfKernelColumns = std::max(kernelColumns / 2, 0);
+    int halfKernelRows = std::max(kernelRows / 2, 0);
+    uint64_t tail = tailMask(image.width);
+
+    // Horizontal pass, rows in parallel bands --------------------------------------------
+    BinaryImage rowFiltered(image.width, rows);
+    {
+        int windowLength = 2 * halfKernelColumns + 1;
+
+        // The run is built on a copy shifted right by halfKernelColumns, long enough that every
+        // window [j - h, j + h] of the original row starts at bit j of the copy
+        int runWords = words + (2 * halfKernelColumns + 63) / 64 + 1;
+
+        parallelFor(0, rows, 1, [&](int bandBegin, int bandEnd) {
+            std::vector<uint64_t> source(words);
+            std::vector<uint64_t> run(runWords);
+            std::vector<uint64_t> shifted(runWords);
+
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                std::copy(image.row(i), image.row(i) + words, source.begin());
+                if (words > 0) {
+                    // Bits past the width behave like pixels outside the image
+                    source[words - 1] = (source[words - 1] & ~tail) | (fill & tail);
+                }
+                shiftRow(source.data(), words, run.data(), runWords, -halfKernelColumns, fill);
+
+                // After each step bit j holds the combination of `covered` bits starting at j
+                int covered = 1;
+                while (covered * 2 <= windowLength) {
+                    shiftRow(run.data(), runWords, shifted.data(), runWords, covered, fill);
+                    for (int w = 0; w < runWords; ++w) run[w] = combine(run[w], shifted[w]);
+                    covered *= 2;
+                }
+                if (covered < windowLength) {
+                    shiftRow(run.data(), runWords, shifted.data(), runWords, windowLength - covered, fill);
+                    for (int w = 0; w < runWords; ++w) run[w] = combine(run[w], shifted[w]);
+                }
+
+                std::copy(run.begin(), run.begin() + words, rowFiltered.row(i));
+            }
+        });
+    }
+
+    // Vertical pass ---------------------------------------------------------------------
+    int windowLength = 2 * halfKernelRows + 1;
+    int paddedLength = (rows + 2 * halfKernelRows + windowLength - 1) / windowLength * windowLength;
+
+    std::vector<uint64_t> identityRow(words, fill);
+    auto paddedRow = [&](int x) -> const uint64_t* {
+        int source = x - halfKernelRows;
+        return (source >= 0 && source < rows) ? rowFiltered.row(source) : identityRow.data();
+    };
+
+    std::vector<uint64_t> prefix(static_cast<size_t>(paddedLength) * words);
+    std::vector<uint64_t> suffix(static_cast<size_t>(paddedLength) * words);
+
+    for (int x = 0; x < paddedLength; ++x) {
+        const uint64_t* source = paddedRow(x);
+        uint64_t* current = prefix.data() + static_cast<size_t>(x) * words;
+        for (int w = 0; w < words; ++w) {
+            current[w] = (x % windowLength == 0) ? source[w] : combine(current[w - words], source[w]);
+        }
+    }
+
+    for (int x = paddedLength - 1; x >= 0; --x) {
+        const uint64_t* source = paddedRow(x);
+        uint64_t* current = suffix.data() + static_cast<size_t>(x) * words;
+        for (int w = 0; w < words; ++w) {
+            current[w] = ((x + 1) % windowLength == 0) ? source[w] : combine(current[w + words], source[w]);
+        }
+    }
+
+    BinaryImage outputImage(image.width, rows);
+    for (int i = 0; i < rows; ++i) {
+        const uint64_t* head = suffix.data() + static_cast<size_t>(i) * words;
+        const uint64_t* tailRow = prefix.data() + static_cast<size_t>(i + windowLength - 1) * words;
+        uint64_t* destination = outputImage.row(i);
+        for (int w = 0; w < words; ++w) {
+            destination[w] = combine(head[w], tailRow[w]);
+        }
+        if (words > 0) {
+            destination[words - 1] &= ~tail;
+        }
+    }
+
+    return outputImage;
+}
+
+BinaryImage applyBinaryErosion(const BinaryImage& image, int kernelColumns, int kernelRows) {
+    return applyBinaryRankFilter(image, kernelColumns, kernelRows, ~uint64_t(0),
+                                 [](uint64_t a, uint64_t b) { return a & b; });
+}
+
+BinaryImage applyBinaryDilation(const BinaryImage& image, int kernelColumns, int kernelRows) {
+    return applyBinaryRankFilter(image, kernelColumns, kernelRows, uint64_t(0),
+                                 [](uint64_t a, uint64_t b) { return a | b; });
+}
+
+// Opening: Erosion followed by Dilation
+BinaryImage applyBinaryOpening(const BinaryImage& image, int kernelColumns, int kernelRows) {
+    return applyBinaryDilation(applyBinaryErosion(image, kernelColumns, kernelRows), kernelColumns, kernelRows);
+}
+
+// Closing: Dilation followed by Erosion
+BinaryImage applyBinaryClosing(const BinaryImage& image, int kernelColumns, int kernelRows) {
+    return applyBinaryErosion(applyBinaryDilation(image, kernelColumns, kernelRows), kernelColumns, kernelRows);
+}
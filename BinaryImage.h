@@ -0,0 +1,67 @@
+#ifndef BINARY_IMAGE_H
+#define BINARY_IMAGE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "ImageIO.h"    // To use ImageReadResult struct
+
+/**
+ * @brief A 1 bit per pixel image packed into 64-bit words.
+ *
+ * Rows are stored one after another, each padded to a whole number of words.
+ * Pixel (r, c) is bit (c % 64) of word (c / 64) of row r, so pixel c + 1 is the
+ * next more significant bit. Padding bits at the end of a row are always 0.
+ */
+struct BinaryImage {
+    int width = 0;          // Image width in pixels
+    int height = 0;         // Image height in pixels
+    int wordsPerRow = 0;    // Number of 64-bit words per row
+    std::vector<uint64_t> bits;
+
+    BinaryImage(int w = 0, int h = 0)
+        : width(w), height(h), wordsPerRow((w + 63) / 64),
+          bits(static_cast<size_t>(wordsPerRow) * h, 0) {}
+
+    uint64_t* row(int r) { return bits.data() + static_cast<size_t>(r) * wordsPerRow; }
+    const uint64_t* row(int r) const { return bits.data() + static_cast<size_t>(r) * wordsPerRow; }
+
+    bool get(int r, int c) const { return (row(r)[c / 64] >> (c % 64)) & 1; }
+    void set(int r, int c, bool value) {
+        uint64_t mask = uint64_t(1) << (c % 64);
+        row(r)[c / 64] = value ? (row(r)[c / 64] | mask) : (row(r)[c / 64] & ~mask);
+    }
+};
+
+/**
+ * @brief Thresholds a grayscale image straight into packed form.
+ *
+ * Same rule as applyGrayscaleToBinary: pixels above the threshold become 1 (white).
+ */
+BinaryImage packBinaryImage(const ImageReadResult& inputImage, int threshold);
+BinaryImage packBinaryImage(const ImageView& input, int threshold);
+
+/**
+ * @brief Expands a packed image back to one byte per pixel (0 or 255).
+ */
+std::vector<uint8_t> unpackBinaryImage(const BinaryImage& image);
+
+/**
+ * @brief True if every pixel of the image is 0 or 255, i.e. it can be packed without loss.
+ */
+bool isBinaryImage(const ImageReadResult& inputImage);
+bool isBinaryImage(const ImageView& input);
+
+/**
+ * @brief Morphology on packed images with a kernelColumns x kernelRows rectangle.
+ *
+ * Like the grayscale versions in ImageMorphology.h, only in-bounds pixels take part
+ * in the window, so the results unpack to exactly what applyErosion / applyDilation
+ * produce on the 0/255 image.
+ */
+BinaryImage applyBinaryErosion(const BinaryImage& image, int kernelColumns, int kernelRows);
+BinaryImage applyBinaryDilation(const BinaryImage& image, int kernelColumns, int kernelRows);
+BinaryImage applyBinaryOpening(const BinaryImage& image, int kernelColumns, int kernelRows);
+BinaryImage applyBinaryClosing(const BinaryImage& image, int kernelColumns, int kernelRows);
+
+#endif // BINARY_IMAGE_H
@@ -0,0 +1,1094 @@
+#include "ImageIO.h"
+#include "ImageFilter.h"
+#include "ImageMorphology.h"
+#include "ImageEdgeDetection.h"
+#include "ImageConverter.h"
+#include "IntensityTransformations.h"
+#include "ParallelExecutor.h"
+#include "ReferenceKernels.h"
+#include "ImageStream.h"
+#include "TiledImage.h"
+#include "UndoHistory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef IMAGE_PROCESSING_VERSION
+#define IMAGE_PROCESSING_VERSION "unknown"
+#endif
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::vector<int> sizes = {512, 1024, 2048};         // Square images of these sides
+    std::vector<int> kernels = {3, 9, 25};              // Only for operations with a kernel size
+    std::vector<int> threads;                           // Empty for 1 and the hardware thread count
+    int repeat = 5;                                     // Timed runs per case, after one warm-up run
+    std::string filter;                                 // Only operations whose name contains this
+    std::string output;                                 // JSON file, stdout when empty
+
+    bool verify = false;                                // Check every kernel against its reference first
+    std::string baseline;                               // Earlier JSON output to compare the throughput with
+    double maxRegression = 10.0;                        // Percent slower than the baseline that still passes
+};
+
+// One timed configuration
+struct Result {
+    std::string operation;
+    int width = 0;
+    int height = 0;
+    int kernel = 0;                 // 0 when the operation has no kernel size
+    int threads = 0;
+    std::vector<double> seconds;    // One per timed run
+};
+
+// A benchmarked operation; `run` is called with the kernel size (ignored when hasKernel is false)
+struct Benchmark {
+    std::string name;
+    bool hasKernel;
+    std::function<void(int kernel)> run;
+};
+
+static void printUsage(const char *program) {
+    std::cerr <<
+        "Usage: " << program << " [options]\n"
+        "\n"
+        "Times every processing kernel on synthetic 8-bit images and writes the results as JSON.\n"
+        "Exits with 1 if a verified kernel differs from its reference or a result regressed.\n"
+        "\n"
+        "Options:\n"
+        "  --sizes <list>      Image sides to sweep, e.g. 512,1024,2048\n"
+        "  --kernels <list>    Kernel sizes to sweep, e.g. 3,9,25\n"
+        "  --threads <list>    Kernel thread counts to sweep (default: 1 and all hardware threads)\n"
+        "  --repeat <n>        Timed runs per case (default: 5)\n"
+        "  --filter <text>     Only run operations whose name contains <text>\n"
+        "  --output <file>     Write the JSON there instead of to stdout\n"
+        "  --quick             Small sizes and few runs, to check that everything runs\n"
+        "  --verify            First compare every kernel with its reference implementation on\n"
+        "                      random images, kernel sizes and padding modes, and the file-based\n"
+        "                      paths (mapImage, streaming) with their in-memory counterparts, and\n"
+        "                      the run-length coding and undo history\n"
+        "  --baseline <file>   Fail on results slower than in this earlier JSON output\n"
+        "  --max-regression <percent>\n"
+        "                      How much slower than the baseline still passes (default: 10)\n"
+        "  -h, --help          Show this help\n";
+}
+
+static std::vector<int> parseList(const std::string &text, const std::string &option) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char *end = nullptr;
+        long value = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value <= 0 || value > 1 << 16) {
+            throw std::invalid_argument("Invalid value '" + item + "' for " + option + "!");
+        }
+        values.push_back(static_cast<int>(value));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("Empty list for " + option + "!");
+    }
+    return values;
+}
+
+static Options parseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg + "!");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--sizes") {
+            options.sizes = parseList(value(), arg);
+        } else if (arg == "--kernels") {
+            options.kernels = parseList(value(), arg);
+        } else if (arg == "--threads") {
+            options.threads = parseList(value(), arg);
+        } else if (arg == "--repeat") {
+            options.repeat = parseList(value(), arg).front();
+        } else if (arg == "--filter") {
+            options.filter = value();
+        } else if (arg == "--output") {
+            options.output = value();
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--baseline") {
+            options.baseline = value();
+        } else if (arg == "--max-regression") {
+            std::string text = value();
+            char *end = nullptr;
+            options.maxRegression = std::strtod(text.c_str(), &end);
+            if (text.empty() || *end != '\0' || !(options.maxRegression >= 0.0)) {
+                throw std::invalid_argument("Invalid value '" + text + "' for " + arg + "!");
+            }
+        } else if (arg == "--quick") {
+            options.sizes = {128};
+            options.kernels = {3};
+            options.repeat = 2;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg + "!");
+        }
+    }
+
+    if (options.threads.empty()) {
+        int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        options.threads = {1};
+        if (hardwareThreads > 1) {
+            options.threads.push_back(hardwareThreads);
+        }
+    }
+    return options;
+}
+
+// Synthetic images -------------------------------------------------------------------------
+
+static void putLittleEndian(std::vector<uint8_t> &bytes, size_t offset, uint32_t value, int size) {
+    for (int i = 0; i < size; ++i) {
+        bytes[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief An 8-bit grayscale image with a complete BMP header, so it can also be written.
+ *
+ * The pixels are smooth gradients plus noise: flat areas, edges and texture, so kernels
+ * with data-dependent cost (median histograms, Canny hysteresis) do representative work.
+ * With binary set, the same image is thresholded to 0 / 255.
+ */
+static ImageReadResult makeSyntheticImage(int width, int height, bool binary) {
+    ImageReadResult image;
+    image.meta = ImageMetadata(width, height, 8);
+
+    uint32_t rowSize = ((static_cast<uint32_t>(width) * 8 + 31) / 32) * 4;
+    uint32_t pixelOffset = HEADER_SIZE + COLOR_TABLE_SIZE;
+    image.header.assign(HEADER_SIZE, 0);
+    image.header[0] = 'B';
+    image.header[1] = 'M';
+    putLittleEndian(image.header, 2, pixelOffset + rowSize * height, 4);     // File size
+    putLittleEndian(image.header, 10, pixelOffset, 4);                      // Pixel data offset
+    putLittleEndian(image.header, 14, 40, 4);                               // Info header size
+    putLittleEndian(image.header, 18, width, 4);
+    putLittleEndian(image.header, 22, height, 4);
+    putLittleEndian(image.header, 26, 1, 2);                                // Planes
+    putLittleEndian(image.header, 28, 8, 2);                                // Bit depth
+    putLittleEndian(image.header, 34, rowSize * height, 4);                 // Pixel data size
+    putLittleEndian(image.header, 46, 256, 4);                              // Colors used
+
+    image.colorTable.assign(COLOR_TABLE_SIZE, 0);
+    for (int i = 0; i < 256; ++i) {
+        image.colorTable[4 * i] = image.colorTable[4 * i + 1] = image.colorTable[4 * i + 2] = static_cast<uint8_t>(i);
+    }
+
+    std::mt19937 random(static_cast<uint32_t>(width * 7919 + height));
+    std::normal_distribution<double> noise(0.0, 12.0);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+    for (int r = 0; r < height; ++r) {
+        for (int c = 0; c < width; ++c) {
+            double value = 128.0 + 80.0 * std::sin(c * 0.02) * std::cos(r * 0.015) + noise(random);
+            if (((c / 64) + (r / 64)) % 2 == 0) {
+                value += 40.0;
+            }
+            uint8_t gray = static_cast<uint8_t>(std::clamp(value, 0.0, 255.0));
+            pixels[static_cast<size_t>(r) * width + c] = binary ? (gray >= 128 ? 255 : 0) : gray;
+        }
+    }
+    image.buffer = std::move(pixels);
+    return image;
+}
+
+// Timing -----------------------------------------------------------------------------------
+
+// Lets only errors through the log while it is alive, so kernel chatter neither ends up in the output nor in the timings
+class QuietScope {
+public:
+    QuietScope() : savedLevel(logLevel()) { setLogLevel(ERROR); }
+    ~QuietScope() { setLogLevel(savedLevel); }
+
+private:
+    LogLevel savedLevel;
+};
+
+static std::vector<double> timeRuns(const std::function<void()> &run, int repeat) {
+    using Clock = std::chrono::steady_clock;
+    QuietScope quiet;
+
+    run();      // Warm-up: first-touch page faults, executor start-up, caches
+
+    std::vector<double> seconds;
+    for (int i = 0; i < repeat; ++i) {
+        Clock::time_point start = Clock::now();
+        run();
+        seconds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return seconds;
+}
+
+static double mean(const std::vector<double> &values) {
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+// Sample standard deviation, 0 for fewer than two values
+static double standardDeviation(const std::vector<double> &values) {
+    if (values.size() < 2) {
+        return 0.0;
+    }
+    double average = mean(values);
+    double sum = 0.0;
+    for (double value : values) {
+        sum += (value - average) * (value - average);
+    }
+    return std::sqrt(sum / (values.size() - 1));
+}
+
+// Pixels per second of each timed run
+static std::vector<double> throughputOf(const Result &result) {
+    double pixels = static_cast<double>(result.width) * result.height;
+    std::vector<double> throughput;
+    for (double seconds : result.seconds) {
+        throughput.push_back(pixels / std::max(seconds, 1e-12));
+    }
+    return throughput;
+}
+
+// Output -----------------------------------------------------------------------------------
+
+static void writeJson(std::ostream &out, const Options &options, const std::vector<Result> &results) {
+    out.precision(6);
+    out << "{\n"
+        << "  \"version\": \"" << IMAGE_PROCESSING_VERSION << "\",\n"
+        << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+        << "  \"repeat\": " << options.repeat << ",\n"
+        << "  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        std::vector<double> throughput = throughputOf(result);
+
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"operation\": \"" << result.operation << "\""
+            << ", \"width\": " << result.width
+            << ", \"height\": " << result.height
+            << ", \"kernel\": " << result.kernel
+            << ", \"threads\": " << result.threads
+            << ", \"runs\": " << result.seconds.size()
+            << ", \"meanSeconds\": " << mean(result.seconds)
+            << ", \"minSeconds\": " << *std::min_element(result.seconds.begin(), result.seconds.end())
+            << ", \"stddevSeconds\": " << standardDeviation(result.seconds)
+            << ", \"pixelsPerSecond\": " << mean(throughput)
+            << ", \"pixelsPerSecondStddev\": " << standardDeviation(throughput) << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Equivalence checks -----------------------------------------------------------------------
+
+// How far an optimized kernel may stray from its reference
+struct Tolerance {
+    int maxDifference = 0;              // Pixels differing by more than this are mismatches
+    double maxMismatchFraction = 0.0;   // Share of the pixels that may be mismatches
+};
+
+static const Tolerance BIT_EXACT{0, 0.0};
+static const Tolerance ROUNDING{1, 0.0};        // Float vs double arithmetic, rounded down differently
+static const Tolerance EDGE_MAP{0, 0.02};       // Canny: a rounding step may move a few edge pixels
+
+static ImageReadResult makeRandomImage(int width, int height, uint32_t seed, bool binary) {
+    ImageReadResult image;
+    image.meta = ImageMetadata(width, height, 8);
+    image.header.assign(HEADER_SIZE, 0);
+    image.colorTable.assign(COLOR_TABLE_SIZE, 0);
+
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+    for (uint8_t &pixel : pixels) {
+        pixel = binary ? ((random() & 3) ? 255 : 0) : static_cast<uint8_t>(random());
+    }
+    image.buffer = std::move(pixels);
+    return image;
+}
+
+// Prints the mismatch and returns false when optimized is further from reference than allowed
+static bool compareOutputs(const std::string &label, const std::vector<uint8_t> &optimized,
+                           const std::vector<uint8_t> &reference, const Tolerance &tolerance) {
+    if (optimized.size() != reference.size()) {
+        std::cerr << "MISMATCH " << label << ": " << optimized.size() << " pixels, reference has "
+                  << reference.size() << "\n";
+        return false;
+    }
+
+    size_t mismatches = 0;
+    size_t worst = 0;
+    int maxDifference = 0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        int difference = std::abs(static_cast<int>(optimized[i]) - static_cast<int>(reference[i]));
+        if (difference > tolerance.maxDifference) {
+            ++mismatches;
+        }
+        if (difference > maxDifference) {
+            maxDifference = difference;
+            worst = i;
+        }
+    }
+
+    if (mismatches <= tolerance.maxMismatchFraction * reference.size()) {
+        return true;
+    }
+    std::cerr << "MISMATCH " << label << ": " << mismatches << " of " << reference.size()
+              << " pixels differ, by up to " << maxDifference << " (pixel " << worst << ": "
+              << int(optimized[worst]) << " instead of " << int(reference[worst]) << ")\n";
+    return false;
+}
+
+// The rows of an 8-bit image copied with `extra` bytes of junk after each, to check the view kernels honour the stride
+static std::vector<uint8_t> stridedCopy(const ImageReadResult &image, int extra) {
+    int width = image.meta.width;
+    std::vector<uint8_t> rows(static_cast<size_t>(width + extra) * image.meta.height, 0xAB);
+    for (int r = 0; r < image.meta.height; ++r) {
+        std::copy_n(image.buffer->data() + static_cast<size_t>(r) * width, width, rows.begin() + static_cast<size_t>(r) * (width + extra));
+    }
+    return rows;
+}
+
+// Cuts an image into tiles of the given size, runs a tiled operation on it and returns the packed result
+static std::vector<uint8_t> runTiled(const ImageReadResult &image, int tileSize,
+                                     const std::function<TiledImage(const TiledImage &)> &operation) {
+    TiledImage tiled(image.meta, tileSize);
+    tiled.header = image.header;
+    tiled.colorTable = image.colorTable;
+    tiled.writeRegion(0, 0, image.meta.width, image.meta.height, image.buffer->data());
+
+    TiledImage result = operation(tiled);
+    std::vector<uint8_t> pixels(image.buffer->size());
+    result.readRegion(0, 0, image.meta.width, image.meta.height, pixels.data());
+    return pixels;
+}
+
+/**
+ * @brief Runs every optimized kernel against its reference implementation.
+ *
+ * Random grayscale and binary images of awkward sizes (single pixels, thin strips, odd
+ * sides) and one smooth synthetic image, under every kernel size, kernel choice and
+ * PaddingChoice the kernel takes, once per thread count of the sweep. The tiled versions
+ * are checked against the whole-image kernels, with tiles that do not divide the image.
+ *
+ * @return The number of mismatching cases.
+ */
+static int verifyKernels(const Options &options) {
+    const int sizes[][2] = {{1, 1}, {2, 3}, {7, 5}, {17, 13}, {64, 48}, {33, 70}, {65, 9}, {128, 4}, {200, 31}};
+    const int kernels[] = {1, 2, 3, 4, 5, 7, 9, 15};
+    const PaddingChoice paddings[] = {PaddingChoice::NONE, PaddingChoice::ZERO, PaddingChoice::REPLICATE, PaddingChoice::REFLECT};
+    const KernelChoice gradients[] = {KernelChoice::SOBEL, KernelChoice::PREWITT, KernelChoice::ROBERTS};
+    const char *paddingNames[] = {"none", "zero", "replicate", "reflect"};
+
+    std::vector<std::pair<ImageReadResult, ImageReadResult>> images;     // Grayscale and binary
+    for (const auto &size : sizes) {
+        uint32_t seed = static_cast<uint32_t>(size[0] * 31 + size[1] * 7);
+        images.emplace_back(makeRandomImage(size[0], size[1], seed, false), makeRandomImage(size[0], size[1], seed, true));
+    }
+    images.emplace_back(makeSyntheticImage(96, 80, false), makeSyntheticImage(96, 80, true));
+
+    int cases = 0;
+    int failures = 0;
+    for (int threads : options.threads) {
+        setParallelThreadCount(threads);
+
+        for (const auto &[gray, binary] : images) {
+            std::string where = " " + std::to_string(gray.meta.width) + "x" + std::to_string(gray.meta.height) +
+                                " threads=" + std::to_string(threads);
+
+            auto check = [&](const std::string &name, const std::string &detail, const Tolerance &tolerance,
+                             const std::function<std::vector<uint8_t>()> &optimized,
+                             const std::function<std::vector<uint8_t>()> &reference) {
+                if (name.find(options.filter) == std::string::npos) {
+                    return;
+                }
+                std::vector<uint8_t> optimizedOutput;
+                std::vector<uint8_t> referenceOutput;
+                {
+                    QuietScope quiet;
+                    optimizedOutput = optimized();
+                    referenceOutput = reference();
+                }
+                ++cases;
+                if (!compareOutputs(name + where + detail, optimizedOutput, referenceOutput, tolerance)) {
+                    ++failures;
+                }
+            };
+
+            for (int k : kernels) {
+                std::string kernel = " k=" + std::to_string(k);
+                double sigma = std::max(k / 6.0, 0.5);
+
+                check("box", kernel, BIT_EXACT, [&] { return applyBoxFilter(gray, k); },
+                      [&] { return referenceBoxFilter(gray, k); });
+                check("gaussian", kernel, ROUNDING, [&] { return applyGaussianFilter(gray, k, sigma); },
+                      [&] { return referenceGaussianFilter(gray, k, sigma); });
+                check("median", kernel, BIT_EXACT, [&] { return applyMedianFilter(gray, k); },
+                      [&] { return referenceMedianFilter(gray, k); });
+
+                // Morphology with non-square windows, on grayscale and on binary (bit-packed) input
+                for (const ImageReadResult *image : {&gray, &binary}) {
+                    std::string window = kernel + "x" + std::to_string(k + 2) + (image == &binary ? " binary" : "");
+                    check("erosion", window, BIT_EXACT, [&] { return applyErosion(*image, k, k + 2); },
+                          [&] { return referenceErosion(*image, k, k + 2); });
+                    check("dilation", window, BIT_EXACT, [&] { return applyDilation(*image, k, k + 2); },
+                          [&] { return referenceDilation(*image, k, k + 2); });
+                    check("opening", window, BIT_EXACT, [&] { return applyOpening(*image, k, k + 2); },
+                          [&] { return referenceOpening(*image, k, k + 2); });
+                    check("closing", window, BIT_EXACT, [&] { return applyClosing(*image, k, k + 2); },
+                          [&] { return referenceClosing(*image, k, k + 2); });
+                    check("boundaryExtraction", window, BIT_EXACT, [&] { return applyBoundaryExtraction(*image, k, k + 2); },
+                          [&] { return referenceBoundaryExtraction(*image, k, k + 2); });
+                }
+
+                for (int p = 0; p < 4; ++p) {
+                    check("canny", kernel + " padding=" + paddingNames[p], EDGE_MAP,
+                          [&] { return applyCannyEdgeDetection(gray, 40.0, 100.0, sigma, k, paddings[p]); },
+                          [&] { return referenceCannyEdgeDetection(gray, 40.0, 100.0, sigma, k, paddings[p]); });
+                }
+            }
+
+            for (int choice = 1; choice <= 5; ++choice) {
+                std::string kernel = " kernel=" + std::to_string(choice);
+                check("highPass", kernel, BIT_EXACT, [&] { return applyHighPassFilter(gray, choice); },
+                      [&] { return referenceHighPassFilter(gray, choice); });
+                check("sharpening", kernel, BIT_EXACT, [&] { return applyImageSharpening(gray, choice); },
+                      [&] { return referenceImageSharpening(gray, choice); });
+            }
+
+            for (KernelChoice gradient : gradients) {
+                for (int p = 0; p < 4; ++p) {
+                    for (bool threshold : {false, true}) {
+                        std::string detail = " kernel=" + std::to_string(static_cast<int>(gradient)) +
+                                             " padding=" + paddingNames[p] + (threshold ? " threshold" : "");
+                        check("gradient", detail, BIT_EXACT,
+                              [&] { return applyGradientEdgeDetection(gray, gradient, threshold, 150.0, paddings[p]); },
+                              [&] { return referenceGradientEdgeDetection(gray, gradient, threshold, 150.0, paddings[p]); });
+                    }
+                }
+            }
+
+            // Tiles smaller than the halo and sides that are not a multiple of the tile; opening and closing need twice the halo
+            for (int tileSize : {5, 16, 33}) {
+                for (int k : {3, 5}) {
+                    std::string detail = " tile=" + std::to_string(tileSize) + " k=" + std::to_string(k);
+                    double sigma = std::max(k / 6.0, 0.5);
+                    auto tiled = [tileSize](const ImageReadResult &image, std::function<TiledImage(const TiledImage &)> operation) {
+                        return [&image, tileSize, operation] { return runTiled(image, tileSize, operation); };
+                    };
+
+                    check("boxTiled", detail, BIT_EXACT, tiled(gray, [&](const TiledImage &in) { return applyBoxFilterTiled(in, k); }),
+                          [&] { return applyBoxFilter(gray, k); });
+                    check("gaussianTiled", detail, BIT_EXACT,
+                          tiled(gray, [&](const TiledImage &in) { return applyGaussianFilterTiled(in, k, sigma); }),
+                          [&] { return applyGaussianFilter(gray, k, sigma); });
+                    check("medianTiled", detail, BIT_EXACT, tiled(gray, [&](const TiledImage &in) { return applyMedianFilterTiled(in, k); }),
+                          [&] { return applyMedianFilter(gray, k); });
+                    check("highPassTiled", " tile=" + std::to_string(tileSize) + " kernel=" + std::to_string(k), BIT_EXACT,
+                          tiled(gray, [&](const TiledImage &in) { return applyHighPassFilterTiled(in, k); }),
+                          [&] { return applyHighPassFilter(gray, k); });
+
+                    for (const ImageReadResult *image : {&gray, &binary}) {
+                        std::string window = detail + "x" + std::to_string(k + 2) + (image == &binary ? " binary" : "");
+                        check("erosionTiled", window, BIT_EXACT,
+                              tiled(*image, [&](const TiledImage &in) { return applyErosionTiled(in, k, k + 2); }),
+                              [&] { return applyErosion(*image, k, k + 2); });
+                        check("dilationTiled", window, BIT_EXACT,
+                              tiled(*image, [&](const TiledImage &in) { return applyDilationTiled(in, k, k + 2); }),
+                              [&] { return applyDilation(*image, k, k + 2); });
+                        check("openingTiled", window, BIT_EXACT,
+                              tiled(*image, [&](const TiledImage &in) { return applyOpeningTiled(in, k, k + 2); }),
+                              [&] { return applyOpening(*image, k, k + 2); });
+                        check("closingTiled", window, BIT_EXACT,
+                              tiled(*image, [&](const TiledImage &in) { return applyClosingTiled(in, k, k + 2); }),
+                              [&] { return applyClosing(*image, k, k + 2); });
+                        check("boundaryExtractionTiled", window, BIT_EXACT,
+                              tiled(*image, [&](const TiledImage &in) { return applyBoundaryExtractionTiled(in, k, k + 2); }),
+                              [&] { return applyBoundaryExtraction(*image, k, k + 2); });
+                    }
+                }
+            }
+
+            check("grayscaleToBinary", "", BIT_EXACT, [&] { return applyGrayscaleToBinary(gray, 128); },
+                  [&] { return referenceGrayscaleToBinary(gray, 128); });
+
+            // Edge detection and thresholding on a view whose rows are not packed (a mapped BMP, say)
+            std::vector<uint8_t> stridedRows = stridedCopy(gray, 3);
+            ImageView strided{stridedRows.data(), gray.meta.width, gray.meta.height, gray.meta.width + 3};
+            for (int p = 0; p < 4; ++p) {
+                check("gradientView", std::string(" padding=") + paddingNames[p], BIT_EXACT,
+                      [&] { return applyGradientEdgeDetection(strided, KernelChoice::SOBEL, false, 0.0, paddings[p]).pixels; },
+                      [&] { return referenceGradientEdgeDetection(gray, KernelChoice::SOBEL, false, 0.0, paddings[p]); });
+                check("cannyView", std::string(" padding=") + paddingNames[p], EDGE_MAP,
+                      [&] { return applyCannyEdgeDetection(strided, 40.0, 100.0, 1.0, 5, paddings[p]).pixels; },
+                      [&] { return referenceCannyEdgeDetection(gray, 40.0, 100.0, 1.0, 5, paddings[p]); });
+            }
+            check("grayscaleToBinaryView", "", BIT_EXACT, [&] { return applyGrayscaleToBinary(strided, 128).pixels; },
+                  [&] { return referenceGrayscaleToBinary(gray, 128); });
+
+            // The intensity transforms work in place
+            auto inPlace = [&](const std::function<void(uint8_t *, const ImageMetadata &)> &transform) {
+                std::vector<uint8_t> pixels = *gray.buffer;
+                transform(pixels.data(), gray.meta);
+                return pixels;
+            };
+            double logScale = 255.0 / std::log(256.0);
+            check("negative", "", BIT_EXACT, [&] { return inPlace(applyNegative); },
+                  [&] { return inPlace(referenceNegative); });
+            check("logTransform", "", BIT_EXACT,
+                  [&] { return inPlace([&](uint8_t *p, const ImageMetadata &m) { applyLogTransform(p, m, logScale); }); },
+                  [&] { return inPlace([&](uint8_t *p, const ImageMetadata &m) { referenceLogTransform(p, m, logScale); }); });
+            for (double gamma : {0.4, 2.2}) {
+                check("gammaTransform", " gamma=" + std::to_string(gamma), BIT_EXACT,
+                      [&] { return inPlace([&](uint8_t *p, const ImageMetadata &m) { applyGammaTransform(p, m, 1.0, gamma); }); },
+                      [&] { return inPlace([&](uint8_t *p, const ImageMetadata &m) { referenceGammaTransform(p, m, 1.0, gamma); }); });
+            }
+        }
+    }
+
+    std::cerr << "Verified " << cases << " cases against the reference kernels, " << failures << " failed" << std::endl;
+    return failures;
+}
+
+/**
+ * @brief Checks the paths that go through files against their in-memory counterparts.
+ *
+ * mapImage against readImage, on widths whose rows carry 0 to 3 bytes of padding, and on
+ * a missing and a truncated file; the streamed operations against the in-memory ones,
+ * under every PaddingChoice. Files are written to `directory`.
+ *
+ * @return The number of mismatching cases.
+ */
+static int verifyFiles(const Options &options, const fs::path &directory) {
+    int cases = 0;
+    int failures = 0;
+    auto expect = [&](bool ok, const std::string &label) {
+        ++cases;
+        if (!ok) {
+            std::cerr << "MISMATCH " << label << "\n";
+            ++failures;
+        }
+    };
+
+    if (std::string("mapImage").find(options.filter) != std::string::npos) {
+        QuietScope quiet;
+        for (int width : {1, 2, 3, 4, 5, 37}) {
+            for (int height : {1, 3, 16}) {
+                std::string label = "mapImage " + std::to_string(width) + "x" + std::to_string(height);
+                std::string path = (directory / ("map-" + std::to_string(width) + "x" + std::to_string(height) + ".bmp")).string();
+                if (!writeImage(path, makeSyntheticImage(width, height, false))) {
+                    throw std::runtime_error("Failed to write " + path + "!");
+                }
+
+                ImageReadResult read = readImage(path);
+                MappedImage mapped = mapImage(path);
+                if (!read.buffer.has_value() || !mapped.isValid()) {
+                    expect(false, label + ": could not be read back");
+                    continue;
+                }
+
+                const ImageMetadata &meta = mapped.meta();
+                expect(meta.width == read.meta.width && meta.height == read.meta.height && meta.bitDepth == read.meta.bitDepth,
+                       label + ": metadata differs");
+                expect(std::equal(read.header.begin(), read.header.end(), mapped.header()) && read.header.size() == HEADER_SIZE,
+                       label + ": header differs");
+                expect(read.colorTable.size() == mapped.colorTableSize() &&
+                           std::equal(read.colorTable.begin(), read.colorTable.end(), mapped.colorTable()),
+                       label + ": color table differs");
+
+                // The view strides over the row padding of the file; the rows themselves match the packed buffer
+                ImageView view = mapped.view();
+                expect(view.stride == static_cast<ptrdiff_t>((width + 3) & ~3), label + ": stride is not the padded row size");
+                bool rowsMatch = true;
+                for (int r = 0; r < height; ++r) {
+                    rowsMatch = rowsMatch && std::equal(view.row(r), view.row(r) + width, read.buffer->data() + static_cast<size_t>(r) * width);
+                }
+                expect(rowsMatch, label + ": view rows differ");
+
+                ImageReadResult copied = mapped.toImageReadResult();
+                expect(copied.buffer.has_value() && *copied.buffer == *read.buffer && copied.header == read.header &&
+                           copied.colorTable == read.colorTable,
+                       label + ": toImageReadResult differs");
+            }
+        }
+
+        std::string missing = (directory / "missing.bmp").string();
+        expect(!mapImage(missing).isValid() && !readImage(missing).buffer.has_value(), "mapImage: missing file accepted");
+
+        std::string truncated = (directory / "truncated.bmp").string();
+        writeImage(truncated, makeSyntheticImage(37, 16, false));
+        fs::resize_file(truncated, HEADER_SIZE + COLOR_TABLE_SIZE + 100);
+        expect(!mapImage(truncated).isValid() && !readImage(truncated).buffer.has_value(), "mapImage: truncated file accepted");
+    }
+
+    if (std::string("stream").find(options.filter) != std::string::npos) {
+        const PaddingChoice paddings[] = {PaddingChoice::NONE, PaddingChoice::ZERO, PaddingChoice::REPLICATE, PaddingChoice::REFLECT};
+        const char *paddingNames[] = {"none", "zero", "replicate", "reflect"};
+        QuietScope quiet;
+
+        for (const auto &size : {std::pair{1, 1}, std::pair{2, 3}, std::pair{37, 16}, std::pair{64, 5}}) {
+            auto [width, height] = size;
+            ImageReadResult image = makeSyntheticImage(width, height, false);
+            image.buffer = *makeRandomImage(width, height, static_cast<uint32_t>(width * 31 + height), false).buffer;
+            std::string where = " " + std::to_string(width) + "x" + std::to_string(height);
+            std::string input = (directory / "stream-in.bmp").string();
+            std::string output = (directory / "stream-out.bmp").string();
+            if (!writeImage(input, image)) {
+                throw std::runtime_error("Failed to write " + input + "!");
+            }
+
+            // Runs `streamed` from input to output and compares what it wrote with `expected`
+            auto check = [&](const std::string &label, const std::function<bool()> &streamed, const std::vector<uint8_t> &expected) {
+                ++cases;
+                ImageReadResult written;
+                if (!streamed() || !(written = readImage(output)).buffer.has_value()) {
+                    std::cerr << "MISMATCH " << label << ": stream failed\n";
+                    ++failures;
+                } else if (written.header != image.header || written.colorTable != image.colorTable) {
+                    std::cerr << "MISMATCH " << label << ": header or color table differs\n";
+                    ++failures;
+                } else if (!compareOutputs(label, *written.buffer, expected, BIT_EXACT)) {
+                    ++failures;
+                }
+            };
+
+            std::vector<uint8_t> negative = *image.buffer;
+            applyNegative(negative.data(), image.meta);
+            check("streamNegative" + where, [&] { return streamNegative(input, output); }, negative);
+            check("streamThreshold" + where, [&] { return streamThreshold(input, output, 100); }, applyGrayscaleToBinary(image, 100));
+
+            for (KernelChoice gradient : {KernelChoice::SOBEL, KernelChoice::PREWITT, KernelChoice::ROBERTS}) {
+                for (int p = 0; p < 4; ++p) {
+                    for (bool threshold : {false, true}) {
+                        std::string label = "streamGradientEdgeDetection" + where + " kernel=" +
+                                            std::to_string(static_cast<int>(gradient)) + " padding=" + paddingNames[p] +
+                                            (threshold ? " threshold" : "");
+                        check(label,
+                              [&] { return streamGradientEdgeDetection(input, output, gradient, threshold, 150.0, paddings[p]); },
+                              applyGradientEdgeDetection(image, gradient, threshold, 150.0, paddings[p]));
+                    }
+                }
+            }
+        }
+
+        std::string missing = (directory / "missing.bmp").string();
+        expect(!streamNegative(missing, (directory / "stream-out.bmp").string()), "streamNegative: missing file accepted");
+    }
+
+    std::cerr << "Verified " << cases << " file cases, " << failures << " failed" << std::endl;
+    return failures;
+}
+
+/**
+ * @brief Checks the run-length coding and the undo history.
+ *
+ * Round trips of the coding over empty, short, long-run and random data, and rejection of
+ * truncated streams; undo and redo through a history of states of two sizes (so there are
+ * keyframes between the deltas) and with states that only change the point operations, kept
+ * in memory, spilled to files in `directory`, and cut down by the spill budget.
+ *
+ * @return The number of mismatching cases.
+ */
+static int verifyUndoHistory(const Options &options, const fs::path &directory) {
+    int cases = 0;
+    int failures = 0;
+    auto expect = [&](bool ok, const std::string &label) {
+        ++cases;
+        if (!ok) {
+            std::cerr << "MISMATCH " << label << "\n";
+            ++failures;
+        }
+    };
+
+    if (std::string("runLength").find(options.filter) != std::string::npos) {
+        std::mt19937 random(42);
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> inputs = {
+            {"empty", {}},
+            {"one byte", {7}},
+            {"short literal", {1, 2, 3}},
+            {"run below minimum", {5, 5, 5, 1, 1, 1}},
+            {"run at minimum", {9, 9, 9, 9}},
+            {"run of 200", std::vector<uint8_t>(200, 0)},
+            {"run of 100000", std::vector<uint8_t>(100000, 255)},
+        };
+        std::vector<uint8_t> alternating(1000);
+        for (size_t i = 0; i < alternating.size(); ++i) {
+            alternating[i] = (i & 1) ? 255 : 0;
+        }
+        inputs.emplace_back("alternating", alternating);
+        std::vector<uint8_t> noise(5000);
+        for (uint8_t &byte : noise) {
+            byte = static_cast<uint8_t>(random());
+        }
+        inputs.emplace_back("random", noise);
+        std::vector<uint8_t> mixed;
+        while (mixed.size() < 20000) {
+            mixed.insert(mixed.end(), 1 + random() % 300, static_cast<uint8_t>(random() % 3));
+            mixed.push_back(static_cast<uint8_t>(random()));
+        }
+        inputs.emplace_back("mixed runs", mixed);
+
+        for (const auto &[name, data] : inputs) {
+            std::string label = "runLength " + name;
+            std::vector<uint8_t> encoded = encodeRunLength(data.data(), data.size());
+            std::vector<uint8_t> decoded(data.size());
+            try {
+                decodeRunLength(encoded, decoded.data(), decoded.size());
+                expect(decoded == data, label + ": round trip differs");
+            } catch (const std::exception &e) {
+                expect(false, label + ": " + e.what());
+            }
+
+            // A stream holding fewer or more bytes than asked for, or cut short, is corrupt
+            std::vector<uint8_t> scratch(data.size() + 1);
+            auto rejects = [&](const std::vector<uint8_t> &stream, size_t size) {
+                try {
+                    decodeRunLength(stream, scratch.data(), size);
+                    return false;
+                } catch (const std::runtime_error &) {
+                    return true;
+                }
+            };
+            expect(rejects(encoded, data.size() + 1), label + ": decoded into a larger buffer");
+            if (!data.empty()) {
+                expect(rejects(encoded, data.size() - 1), label + ": decoded into a smaller buffer");
+                expect(rejects(std::vector<uint8_t>(encoded.begin(), encoded.end() - 1), data.size()),
+                       label + ": truncated stream accepted");
+            }
+        }
+    }
+
+    if (std::string("undoHistory").find(options.filter) != std::string::npos) {
+        // Each state changes a block of the one before; 5 to 7 have another size, and 3 and 9 only add a point operation
+        std::vector<ImageReadResult> states;
+        std::vector<PointOpChain> pointOps;
+        for (int i = 0; i < 12; ++i) {
+            bool small = i >= 5 && i <= 7;
+            int width = small ? 33 : 40;
+            int height = small ? 20 : 30;
+            ImageReadResult state;
+            PointOpChain ops = pointOps.empty() ? PointOpChain() : pointOps.back();
+            if (i == 3 || i == 9) {
+                state = states.back();
+                deferNegative(ops, state.meta);
+            } else if (!states.empty() && states.back().meta.width == width) {
+                state = states.back();
+                std::vector<uint8_t> &pixels = *state.buffer;
+                for (int r = i; r < i + 6; ++r) {
+                    std::fill_n(pixels.begin() + static_cast<size_t>(r) * width + i, 10, static_cast<uint8_t>(17 * i));
+                }
+            } else {
+                state = makeRandomImage(width, height, static_cast<uint32_t>(i), i % 2 == 0);
+            }
+            states.push_back(state);
+            pointOps.push_back(ops);
+        }
+
+        auto same = [&](const ImageReadResult &image, const PointOpChain &ops, size_t i) {
+            return image.meta.width == states[i].meta.width && image.meta.height == states[i].meta.height &&
+                   image.buffer.has_value() && *image.buffer == *states[i].buffer && ops.size() == pointOps[i].size() &&
+                   ops.lut() == pointOps[i].lut();
+        };
+
+        fs::path spillDirectory = directory / "undo";
+        fs::create_directories(spillDirectory);
+
+        struct Setup {
+            const char *name;
+            size_t memoryBudget;
+            bool spill;
+            size_t spillBudget;
+        };
+        const Setup setups[] = {
+            {"in memory", DEFAULT_UNDO_MEMORY_BUDGET, false, DEFAULT_UNDO_SPILL_BUDGET},
+            {"spilled", 0, true, DEFAULT_UNDO_SPILL_BUDGET},
+            {"spill budget", 0, true, 1000},
+        };
+        for (const Setup &setup : setups) {
+            std::string label = std::string("undoHistory ") + setup.name;
+            UndoHistory history(setup.memoryBudget, setup.spill ? spillDirectory.string() : std::string());
+            history.setSpillBudget(setup.spillBudget);
+
+            ImageReadResult image = states[0];
+            PointOpChain ops = pointOps[0];
+            for (size_t i = 1; i < states.size(); ++i) {
+                history.push(image, ops);
+                image = states[i];
+                ops = pointOps[i];
+            }
+            history.finishEncoding();
+
+            size_t kept = history.undoCount();
+            if (setup.spillBudget == DEFAULT_UNDO_SPILL_BUDGET) {
+                expect(kept == states.size() - 1, label + ": states were dropped");
+            } else {
+                expect(kept < states.size() - 1 && history.spilledBytes() <= setup.spillBudget,
+                       label + ": spill budget not kept");
+            }
+            if (setup.spill) {
+                expect(history.spilledBytes() > 0 && !fs::is_empty(spillDirectory), label + ": nothing was spilled");
+            }
+            history.setSpillBudget(DEFAULT_UNDO_SPILL_BUDGET);     // Walking the states must not drop more of them
+
+            // Back through every state kept, forward to the last one, then back again
+            bool ok = true;
+            for (size_t step = 1; step <= kept; ++step) {
+                ok = history.undo(image, ops) && same(image, ops, states.size() - 1 - step) && ok;
+            }
+            expect(ok && !history.undo(image, ops), label + ": undo differs");
+            ok = true;
+            for (size_t step = kept; step >= 1; --step) {
+                ok = history.redo(image, ops) && same(image, ops, states.size() - step) && ok;
+            }
+            expect(ok && !history.canRedo(), label + ": redo differs");
+            ok = true;
+            for (size_t step = 1; step <= kept; ++step) {
+                ok = history.undo(image, ops) && same(image, ops, states.size() - 1 - step) && ok;
+            }
+            expect(ok, label + ": undo after redo differs");
+
+            // A new state discards the redo states
+            history.push(image, ops);
+            expect(!history.canRedo() && history.undoCount() == 1, label + ": push kept the redo states");
+            history.clear();
+            expect(fs::is_empty(spillDirectory), label + ": spill files left behind");
+        }
+    }
+
+    std::cerr << "Verified " << cases << " run-length and undo cases, " << failures << " failed" << std::endl;
+    return failures;
+}
+
+// Regression gate --------------------------------------------------------------------------
+
+static std::string resultKey(const std::string &operation, int width, int height, int kernel, int threads) {
+    return operation + " " + std::to_string(width) + "x" + std::to_string(height) + " k=" + std::to_string(kernel) +
+           " threads=" + std::to_string(threads);
+}
+
+// The number after "name": on a result line of writeJson, NaN if it has none
+static double jsonNumber(const std::string &line, const std::string &name) {
+    size_t position = line.find("\"" + name + "\": ");
+    if (position == std::string::npos) {
+        return std::nan("");
+    }
+    return std::strtod(line.c_str() + position + name.size() + 4, nullptr);
+}
+
+static std::string jsonString(const std::string &line, const std::string &name) {
+    size_t position = line.find("\"" + name + "\": \"");
+    if (position == std::string::npos) {
+        return std::string();
+    }
+    size_t begin = position + name.size() + 5;
+    return line.substr(begin, line.find('"', begin) - begin);
+}
+
+// Mean pixels per second of each result in a file written by writeJson, by resultKey
+static std::map<std::string, double> loadBaseline(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open baseline " + path + "!");
+    }
+
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string operation = jsonString(line, "operation");
+        if (operation.empty()) {
+            continue;
+        }
+        baseline[resultKey(operation, static_cast<int>(jsonNumber(line, "width")), static_cast<int>(jsonNumber(line, "height")),
+                           static_cast<int>(jsonNumber(line, "kernel")), static_cast<int>(jsonNumber(line, "threads")))] =
+            jsonNumber(line, "pixelsPerSecond");
+    }
+    return baseline;
+}
+
+// Prints and counts the results more than maxRegression percent slower than in the baseline
+static int countRegressions(const std::vector<Result> &results, const std::map<std::string, double> &baseline,
+                            double maxRegression) {
+    int compared = 0;
+    int regressions = 0;
+    for (const Result &result : results) {
+        std::string key = resultKey(result.operation, result.width, result.height, result.kernel, result.threads);
+        auto it = baseline.find(key);
+        if (it == baseline.end() || !(it->second > 0.0)) {
+            continue;
+        }
+
+        ++compared;
+        double current = mean(throughputOf(result));
+        double change = (current / it->second - 1.0) * 100.0;
+        if (change < -maxRegression) {
+            ++regressions;
+            std::cerr << "REGRESSION " << key << ": " << current << " pixels/s, baseline " << it->second << " ("
+                      << change << "%)\n";
+        }
+    }
+
+    std::cerr << "Compared " << compared << " results with the baseline, " << regressions << " more than "
+              << maxRegression << "% slower" << std::endl;
+    return regressions;
+}
+
+// Main -------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    fs::path scratchDirectory = fs::temp_directory_path() / ("image-benchmark-" + std::to_string(std::random_device()()));
+    fs::create_directories(scratchDirectory);
+
+    std::map<std::string, double> baseline;
+    int failures = 0;
+    try {
+        if (!options.baseline.empty()) {
+            baseline = loadBaseline(options.baseline);
+        }
+        if (options.verify) {
+            failures += verifyKernels(options);
+            failures += verifyFiles(options, scratchDirectory);
+            failures += verifyUndoHistory(options, scratchDirectory);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        fs::remove_all(scratchDirectory);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    try {
+        for (int size : options.sizes) {
+            ImageReadResult gray = makeSyntheticImage(size, size, false);
+            ImageReadResult binary = makeSyntheticImage(size, size, true);
+            std::vector<uint8_t> scratch = *gray.buffer;
+            std::string readPath = (scratchDirectory / "read.bmp").string();
+            std::string writePath = (scratchDirectory / "write.bmp").string();
+            if (!writeImage(readPath, gray)) {
+                throw std::runtime_error("Failed to write " + readPath + "!");
+            }
+
+            auto sigmaFor = [](int kernel) { return std::max(kernel / 6.0, 0.5); };     // Kernel spans +-3 sigma
+
+            // applyUMHBF is left out: it asks for its low-pass filter on stdin
+            std::vector<Benchmark> benchmarks = {
+                {"box", true, [&](int k) { applyBoxFilter(gray, k); }},
+                {"gaussian", true, [&](int k) { applyGaussianFilter(gray, k, sigmaFor(k)); }},
+                {"recursiveGaussian", true, [&](int k) { applyRecursiveGaussianFilter(gray, sigmaFor(k)); }},
+                {"median", true, [&](int k) { applyMedianFilter(gray, k); }},
+                {"highPass", false, [&](int) { applyHighPassFilter(gray, 2); }},
+                {"sharpening", false, [&](int) { applyImageSharpening(gray, 2); }},
+                {"erosion", true, [&](int k) { applyErosion(gray, k, k); }},
+                {"dilation", true, [&](int k) { applyDilation(gray, k, k); }},
+                {"erosionBinary", true, [&](int k) { applyErosion(binary, k, k); }},
+                {"dilationBinary", true, [&](int k) { applyDilation(binary, k, k); }},
+                {"opening", true, [&](int k) { applyOpening(gray, k, k); }},
+                {"closing", true, [&](int k) { applyClosing(gray, k, k); }},
+                {"boundaryExtraction", true, [&](int k) { applyBoundaryExtraction(binary, k, k); }},
+                {"gradientSobel", false, [&](int) {
+                    applyGradientEdgeDetection(gray, KernelChoice::SOBEL, true, 100.0, PaddingChoice::REPLICATE);
+                }},
+                {"canny", true, [&](int k) {
+                    applyCannyEdgeDetection(gray, 40.0, 100.0, sigmaFor(k), k, PaddingChoice::REPLICATE);
+                }},
+                {"grayscaleToBinary", false, [&](int) { applyGrayscaleToBinary(gray, 128); }},
+                {"negative", false, [&](int) { applyNegative(scratch.data(), gray.meta); }},
+                {"logTransform", false, [&](int) { applyLogTransform(scratch.data(), gray.meta, 255.0 / std::log(256.0)); }},
+                {"gammaTransform", false, [&](int) { applyGammaTransform(scratch.data(), gray.meta, 1.0, 0.5); }},
+                {"readImage", false, [&](int) {
+                    if (!readImage(readPath).buffer.has_value()) {
+                        throw std::runtime_error("Failed to read " + readPath + "!");
+                    }
+                }},
+                {"writeImage", false, [&](int) {
+                    if (!writeImage(writePath, gray)) {
+                        throw std::runtime_error("Failed to write " + writePath + "!");
+                    }
+                }},
+            };
+
+            for (int threads : options.threads) {
+                setParallelThreadCount(threads);
+
+                for (const Benchmark &benchmark : benchmarks) {
+                    if (benchmark.name.find(options.filter) == std::string::npos) {
+                        continue;
+                    }
+
+                    std::vector<int> kernels = benchmark.hasKernel ? options.kernels : std::vector<int>{0};
+                    for (int kernel : kernels) {
+                        std::cerr << benchmark.name << " " << size << "x" << size;
+                        if (kernel > 0) {
+                            std::cerr << " k=" << kernel;
+                        }
+                        std::cerr << " threads=" << threads << std::endl;
+
+                        Result result;
+                        result.operation = benchmark.name;
+                        result.width = size;
+                        result.height = size;
+                        result.kernel = kernel;
+                        result.threads = threads;
+                        result.seconds = timeRuns([&] { benchmark.run(kernel); }, options.repeat);
+                        results.push_back(std::move(result));
+                    }
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        fs::remove_all(scratchDirectory);
+        return 1;
+    }
+    fs::remove_all(scratchDirectory);
+
+    if (!options.baseline.empty()) {
+        failures += countRegressions(results, baseline, options.maxRegression);
+    }
+
+    if (options.output.empty()) {
+        writeJson(std::cout, options, results);
+    } else {
+        std::ofstream file(options.output);
+        writeJson(file, options, results);
+        if (!file) {
+            std::cerr << "Error: failed to write " << options.output << "\n";
+            return 1;
+        }
+        std::cerr << "Wrote " << results.size() << " results to " << options.output << "\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -1,19 +1,28 @@
 #include "ImageConverter.h"
+#include "IntensityTransformations.h"
 
-std::vector<uint8_t> applyGrayscaleToBinary(const ImageReadResult& inputImage, int threshold) {
-    const uint8_t* buffer = inputImage.buffer->data();
-    const ImageMetadata& meta = inputImage.meta;
+#include <stdexcept>
 
-    int rows = meta.height;
-    int cols = meta.width;
+ImageBuffer applyGrayscaleToBinary(const ImageView& input, int threshold) {
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
+    }
 
-    // Use the provided output buffer or create a new one
-    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    ImageBuffer output(input.width, input.height);
 
-    for (int i = 0; i < rows * cols; ++i) {
-        outputBuffer[i] = (buffer[i] > threshold) ? 255 : 0; // Set binary values: 255 for white, 0 for black
+    // Set binary values: 255 for white, 0 for black
+    IntensityLut lut = makeThresholdLut(threshold);
+    for (int i = 0; i < input.height; ++i) {
+        applyLut(input.row(i), output.row(i), static_cast<size_t>(input.width), lut);
     }
 
-    return outputBuffer;
+    return output;
+}
+
+std::vector<uint8_t> applyGrayscaleToBinary(const ImageReadResult& inputImage, int threshold) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image or missing buffer!");
+    }
 
+    return applyGrayscaleToBinary(viewOf(inputImage), threshold).pixels;
 }
@@ -9,5 +9,8 @@
 // Grayscale to binary
 std::vector<uint8_t> applyGrayscaleToBinary(const ImageReadResult& inputImage, int threshold);
 
+// The same on a strided view of 8-bit rows
+ImageBuffer applyGrayscaleToBinary(const ImageView& input, int threshold);
+
 
 #endif
\ No newline at end of file
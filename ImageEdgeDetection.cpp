@@ -1,26 +1,27 @@
 #include "ImageEdgeDetection.h"
 #include "ImageFilter.h"
+#include "ProcessingControl.h"
+#include "ParallelExecutor.h"
+#include "TraceRecorder.h"
+#include "Instrumentation.h"
 #include <algorithm>       // for std::clamp (C++17) or remove if you have a custom clamp
 #include <cmath>           // for std::sqrt
 #include <cstring>         // for std::memcpy, if needed
 
-std::vector<uint8_t> applyGradientEdgeDetection(
-    const ImageReadResult& inputImage,
+ImageBuffer applyGradientEdgeDetection(
+    const ImageView& input,
     KernelChoice kernelChoice,
     bool applyThreshold,
     double thresholdValue,
     PaddingChoice paddingChoice
 ) {
     // 1. Validate input
-    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
-        throw std::invalid_argument("Invalid image or missing buffer!");
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
     }
 
-    const uint8_t* buffer = inputImage.buffer->data();
-    const ImageMetadata& meta = inputImage.meta;
-
-    int rows = meta.height;
-    int cols = meta.width;
+    int rows = input.height;
+    int cols = input.width;
 
     // 2. Determine kernel type & size
     //    - Sobel & Prewitt are 3x3 => padSize = 1
@@ -88,38 +89,35 @@ std::vector<uint8_t> applyGradientEdgeDetection(
 
     // 3. Physically pad the image (if requested)
     //    We'll create a new buffer "paddedBuffer" with dimension (rows + 2*padSize) x (cols + 2*padSize),
-    //    or if paddingChoice == NONE, we just use the original buffer (but then we must skip edges in the convolution).
-    
+    //    or if paddingChoice == NONE, we just view the original buffer (but then we must skip edges in the convolution).
+
     std::vector<uint8_t> paddedBuffer;
-    int paddedRows = rows + 2 * padSize;
-    int paddedCols = cols + 2 * padSize;
+    ImageView padded = input;
 
     // If user chooses no padding, we won't physically expand. We'll handle edges by skipping them.
-    if (paddingChoice == PaddingChoice::NONE) {
-        // Just copy the original data
-        paddedBuffer = *inputImage.buffer; 
-        paddedRows = rows; 
-        paddedCols = cols;
-    } else {
+    if (paddingChoice != PaddingChoice::NONE) {
         // Use one of the ImageUtils functions
         switch (paddingChoice) {
             case PaddingChoice::ZERO:
-                paddedBuffer = zeroPadImage(*inputImage.buffer, cols, rows, padSize);
+                paddedBuffer = zeroPadImage(input, padSize);
                 break;
             case PaddingChoice::REPLICATE:
-                paddedBuffer = replicatePadImage(*inputImage.buffer, cols, rows, padSize);
+                paddedBuffer = replicatePadImage(input, padSize);
                 break;
             case PaddingChoice::REFLECT:
-                paddedBuffer = reflectPadImage(*inputImage.buffer, cols, rows, padSize);
+                paddedBuffer = reflectPadImage(input, padSize);
                 break;
             default:
                 // Should never happen if we handle all enum cases
                 throw std::runtime_error("Unsupported padding choice.");
         }
+        padded = ImageView{paddedBuffer.data(), cols + 2 * padSize, rows + 2 * padSize, cols + 2 * padSize};
+        countAllocation(paddedBuffer.size());
     }
 
     // We'll store raw gradient magnitudes in a float vector 
     std::vector<float> gradientMagnitudes(rows * cols, 0.0f);
+    countAllocation(gradientMagnitudes.size() * sizeof(float));
 
     // 4. Convolution
     //    We want our final output to match the ORIGINAL image size (rows x cols).
@@ -128,60 +126,65 @@ std::vector<uint8_t> applyGradientEdgeDetection(
 
     auto getPaddedPixel = [&](int r, int c) -> uint8_t {
         // If no padding was used, we risk out-of-bounds. We'll do a simple check:
-        if (r < 0 || r >= paddedRows || c < 0 || c >= paddedCols) {
+        if (r < 0 || r >= padded.height || c < 0 || c >= padded.width) {
             return 0; // or skip, or handle differently
         }
-        return paddedBuffer[r * paddedCols + c];
+        return padded.row(r)[c];
     };
 
     if (isRoberts) {
         // 2x2 operator => we'll basically do:
         // For each valid pixel (i, j) in [0..rows-1], read from padded[i+padSize ...] etc.
-
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                float sumX = 0.f;
-                float sumY = 0.f;
-
-                // The center in padded space if padding is used
-                int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
-                int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
-
-                // Convolve 2x2
-                for (int ki = 0; ki < 2; ++ki) {
-                    for (int kj = 0; kj < 2; ++kj) {
-                        uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
-                        sumX += pixelVal * gx2[ki][kj];
-                        sumY += pixelVal * gy2[ki][kj];
+        // Rows are independent, so they run in parallel bands.
+
+        parallelFor(0, rows, 1, [&](int bandBegin, int bandEnd) {
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                for (int j = 0; j < cols; ++j) {
+                    float sumX = 0.f;
+                    float sumY = 0.f;
+
+                    // The center in padded space if padding is used
+                    int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+                    int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+
+                    // Convolve 2x2
+                    for (int ki = 0; ki < 2; ++ki) {
+                        for (int kj = 0; kj < 2; ++kj) {
+                            uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
+                            sumX += pixelVal * gx2[ki][kj];
+                            sumY += pixelVal * gy2[ki][kj];
+                        }
                     }
+                    float mag = std::sqrt(sumX * sumX + sumY * sumY);
+                    gradientMagnitudes[i * cols + j] = mag;
                 }
-                float mag = std::sqrt(sumX * sumX + sumY * sumY);
-                gradientMagnitudes[i * cols + j] = mag;
             }
-        }
+        });
 
     } else {
         // Sobel/Prewitt => 3x3 operator
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                float sumX = 0.f;
-                float sumY = 0.f;
-
-                int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
-                int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
-
-                // Convolve 3x3
-                for (int ki = -1; ki <= 1; ++ki) {
-                    for (int kj = -1; kj <= 1; ++kj) {
-                        uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
-                        sumX += pixelVal * gx3[ki + 1][kj + 1];
-                        sumY += pixelVal * gy3[ki + 1][kj + 1];
+        parallelFor(0, rows, 1, [&](int bandBegin, int bandEnd) {
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                for (int j = 0; j < cols; ++j) {
+                    float sumX = 0.f;
+                    float sumY = 0.f;
+
+                    int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+                    int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+
+                    // Convolve 3x3
+                    for (int ki = -1; ki <= 1; ++ki) {
+                        for (int kj = -1; kj <= 1; ++kj) {
+                            uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
+                            sumX += pixelVal * gx3[ki + 1][kj + 1];
+                            sumY += pixelVal * gy3[ki + 1][kj + 1];
+                        }
                     }
+                    float mag = std::sqrt(sumX * sumX + sumY * sumY);
+                    gradientMagnitudes[i * cols + j] = mag;
                 }
-                float mag = std::sqrt(sumX * sumX + sumY * sumY);
-                gradientMagnitudes[i * cols + j] = mag;
             }
-        }
+        });
     }
 
     // 5. Now we have the gradient magnitudes for each pixel in the original NxM dimension.
@@ -219,30 +222,48 @@ std::vector<uint8_t> applyGradientEdgeDetection(
         }
     }
 
-    return output;
+    return ImageBuffer(cols, rows, std::move(output));
+}
+
+std::vector<uint8_t> applyGradientEdgeDetection(
+    const ImageReadResult& inputImage,
+    KernelChoice kernelChoice,
+    bool applyThreshold,
+    double thresholdValue,
+    PaddingChoice paddingChoice
+) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image or missing buffer!");
+    }
+
+    return applyGradientEdgeDetection(viewOf(inputImage), kernelChoice, applyThreshold, thresholdValue, paddingChoice).pixels;
 }
 
 // Canny Edge Detection ------------------------------------------------------------------------
 
-std::vector<uint8_t> applyCannyEdgeDetection(
-    const ImageReadResult& inputImage,
+ImageBuffer applyCannyEdgeDetection(
+    const ImageView& input,
     double lowThreshold,
     double highThreshold,
     double sigma,
     int kernelSize,
     PaddingChoice paddingChoice
 ) {
-    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
-        throw std::invalid_argument("Invalid image or missing buffer!");
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
     }
 
-    const uint8_t* buffer = inputImage.buffer->data();
-    const ImageMetadata& meta = inputImage.meta;
-    int rows = meta.height;
-    int cols = meta.width;
+    int rows = input.height;
+    int cols = input.width;
 
-    // 1. Gaussian Smoothing
-    std::vector<uint8_t> smoothedBuffer = applyGaussianFilter(inputImage, kernelSize, sigma);
+    // 1. Gaussian Smoothing (first quarter of the progress; the next three stages share the rest)
+    ImageBuffer smoothed;
+    {
+        ProgressStage stage(0, 4);
+        TraceSpan span("Canny: smoothing");
+        smoothed = applyGaussianFilter(input, kernelSize, sigma);
+        countAllocation(smoothed.pixels.size());
+    }
 
     // 2. Compute Gradients using Sobel Operator
     int gx[3][3] = {
@@ -258,95 +279,106 @@ std::vector<uint8_t> applyCannyEdgeDetection(
 
     std::vector<float> gradientMagnitude(rows * cols, 0.0f);
     std::vector<float> gradientDirection(rows * cols, 0.0f);
+    countAllocation((gradientMagnitude.size() + gradientDirection.size()) * sizeof(float));
 
-    // Padding the smoothed image
+    // Padding the smoothed image (without padding the smoothed image is read in place)
     std::vector<uint8_t> paddedBuffer;
     int padSize = 1;
-    int paddedRows = rows + 2 * padSize;
-    int paddedCols = cols + 2 * padSize;
+    ImageView padded = smoothed.view();
 
-    if (paddingChoice == PaddingChoice::NONE) {
-        paddedBuffer = smoothedBuffer;
-        paddedRows = rows;
-        paddedCols = cols;
-    } else {
+    if (paddingChoice != PaddingChoice::NONE) {
         switch (paddingChoice) {
             case PaddingChoice::ZERO:
-                paddedBuffer = zeroPadImage(smoothedBuffer, cols, rows, padSize);
+                paddedBuffer = zeroPadImage(smoothed.view(), padSize);
                 break;
             case PaddingChoice::REPLICATE:
-                paddedBuffer = replicatePadImage(smoothedBuffer, cols, rows, padSize);
+                paddedBuffer = replicatePadImage(smoothed.view(), padSize);
                 break;
             case PaddingChoice::REFLECT:
-                paddedBuffer = reflectPadImage(smoothedBuffer, cols, rows, padSize);
+                paddedBuffer = reflectPadImage(smoothed.view(), padSize);
                 break;
             default:
                 throw std::runtime_error("Unsupported padding choice.");
         }
+        padded = ImageView{paddedBuffer.data(), cols + 2 * padSize, rows + 2 * padSize, cols + 2 * padSize};
+        countAllocation(paddedBuffer.size());
     }
 
     // Lambda to get padded pixel safely
     auto getPaddedPixel = [&](int r, int c) -> uint8_t {
-        if (r < 0 || r >= paddedRows || c < 0 || c >= paddedCols) {
+        if (r < 0 || r >= padded.height || c < 0 || c >= padded.width) {
             return 0;
         }
-        return paddedBuffer[r * paddedCols + c];
+        return padded.row(r)[c];
     };
 
-    // Compute Gradient Magnitude and Direction
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            float sumX = 0.f;
-            float sumY = 0.f;
-
-            int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
-            int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+    // Compute Gradient Magnitude and Direction, rows in parallel bands
+    {
+        ProgressStage stage(1, 4);
+        TraceSpan span("Canny: gradients");
+        parallelFor(0, rows, 1, [&](int bandBegin, int bandEnd) {
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                for (int j = 0; j < cols; ++j) {
+                    float sumX = 0.f;
+                    float sumY = 0.f;
+
+                    int centerR = i + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+                    int centerC = j + (paddingChoice == PaddingChoice::NONE ? 0 : padSize);
+
+                    for (int ki = -1; ki <= 1; ++ki) {
+                        for (int kj = -1; kj <= 1; ++kj) {
+                            uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
+                            sumX += pixelVal * gx[ki + 1][kj + 1];
+                            sumY += pixelVal * gy[ki + 1][kj + 1];
+                        }
+                    }
 
-            for (int ki = -1; ki <= 1; ++ki) {
-                for (int kj = -1; kj <= 1; ++kj) {
-                    uint8_t pixelVal = getPaddedPixel(centerR + ki, centerC + kj);
-                    sumX += pixelVal * gx[ki + 1][kj + 1];
-                    sumY += pixelVal * gy[ki + 1][kj + 1];
+                    gradientMagnitude[i * cols + j] = std::sqrt(sumX * sumX + sumY * sumY);
+                    gradientDirection[i * cols + j] = std::atan2(sumY, sumX) * 180 / M_PI;
                 }
             }
-
-            gradientMagnitude[i * cols + j] = std::sqrt(sumX * sumX + sumY * sumY);
-            gradientDirection[i * cols + j] = std::atan2(sumY, sumX) * 180 / M_PI;
-        }
+        });
     }
 
     // 3. Non-Maximum Suppression
     std::vector<float> suppressed(rows * cols, 0.0f);       // g_N (x, y)
+    countAllocation(suppressed.size() * sizeof(float));
+
+    {
+        ProgressStage stage(2, 4);
+        TraceSpan span("Canny: non-maximum suppression");
+        parallelFor(1, rows - 1, 1, [&](int bandBegin, int bandEnd) {
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                for (int j = 1; j < cols - 1; ++j) {
+                    float angle = gradientDirection[i * cols + j];
+                    angle = std::fmod(angle + 180.0, 180.0);  // Normalize angle between 0 and 180
+
+                    float magnitude = gradientMagnitude[i * cols + j];
+                    float neighbor1 = 0.0f, neighbor2 = 0.0f;
+
+                    // Determine neighbors to compare
+                    if ((angle >= 0 && angle < 22.5) || (angle >= 157.5 && angle <= 180)) {
+                        neighbor1 = gradientMagnitude[i * cols + (j + 1)];
+                        neighbor2 = gradientMagnitude[i * cols + (j - 1)];
+                    } else if (angle >= 22.5 && angle < 67.5) {
+                        neighbor1 = gradientMagnitude[(i + 1) * cols + (j - 1)];
+                        neighbor2 = gradientMagnitude[(i - 1) * cols + (j + 1)];
+                    } else if (angle >= 67.5 && angle < 112.5) {
+                        neighbor1 = gradientMagnitude[(i + 1) * cols + j];
+                        neighbor2 = gradientMagnitude[(i - 1) * cols + j];
+                    } else if (angle >= 112.5 && angle < 157.5) {
+                        neighbor1 = gradientMagnitude[(i - 1) * cols + (j - 1)];
+                        neighbor2 = gradientMagnitude[(i + 1) * cols + (j + 1)];
+                    }
 
-    for (int i = 1; i < rows - 1; ++i) {
-        for (int j = 1; j < cols - 1; ++j) {
-            float angle = gradientDirection[i * cols + j];
-            angle = std::fmod(angle + 180.0, 180.0);  // Normalize angle between 0 and 180
-
-            float magnitude = gradientMagnitude[i * cols + j];
-            float neighbor1 = 0.0f, neighbor2 = 0.0f;
-
-            // Determine neighbors to compare
-            if ((angle >= 0 && angle < 22.5) || (angle >= 157.5 && angle <= 180)) {
-                neighbor1 = gradientMagnitude[i * cols + (j + 1)];
-                neighbor2 = gradientMagnitude[i * cols + (j - 1)];
-            } else if (angle >= 22.5 && angle < 67.5) {
-                neighbor1 = gradientMagnitude[(i + 1) * cols + (j - 1)];
-                neighbor2 = gradientMagnitude[(i - 1) * cols + (j + 1)];
-            } else if (angle >= 67.5 && angle < 112.5) {
-                neighbor1 = gradientMagnitude[(i + 1) * cols + j];
-                neighbor2 = gradientMagnitude[(i - 1) * cols + j];
-            } else if (angle >= 112.5 && angle < 157.5) {
-                neighbor1 = gradientMagnitude[(i - 1) * cols + (j - 1)];
-                neighbor2 = gradientMagnitude[(i + 1) * cols + (j + 1)];
-            }
-
-            if (magnitude >= neighbor1 && magnitude >= neighbor2) {
-                suppressed[i * cols + j] = magnitude;
-            } else {
-                suppressed[i * cols + j] = 0.0f;
+                    if (magnitude >= neighbor1 && magnitude >= neighbor2) {
+                        suppressed[i * cols + j] = magnitude;
+                    } else {
+                        suppressed[i * cols + j] = 0.0f;
+                    }
+                }
             }
-        }
+        });
     }
 
     // 4. Double Thresholding
@@ -354,17 +386,21 @@ std::vector<uint8_t> applyCannyEdgeDetection(
     const uint8_t strongEdge = 255;
     const uint8_t weakEdge = 75;
 
-    for (int i = 0; i < rows * cols; ++i) {
-        if (suppressed[i] >= highThreshold) {
-            output[i] = strongEdge;
-        } else if (suppressed[i] >= lowThreshold) {
-            output[i] = weakEdge;
-        } else {
-            output[i] = 0;
+    {
+        TraceSpan span("Canny: double threshold");
+        for (int i = 0; i < rows * cols; ++i) {
+            if (suppressed[i] >= highThreshold) {
+                output[i] = strongEdge;
+            } else if (suppressed[i] >= lowThreshold) {
+                output[i] = weakEdge;
+            } else {
+                output[i] = 0;
+            }
         }
     }
 
     // 5. Edge Tracking by Hysteresis
+    //    Stays serial: a weak pixel promoted here can promote the next one in scan order.
     auto isStrongNeighbor = [&](int r, int c) -> bool {
         for (int dr = -1; dr <= 1; ++dr) {
             for (int dc = -1; dc <= 1; ++dc) {
@@ -378,7 +414,10 @@ std::vector<uint8_t> applyCannyEdgeDetection(
         return false;
     };
 
+    TraceSpan span("Canny: hysteresis");
     for (int i = 1; i < rows - 1; ++i) {
+        reportProgress(3 * rows + i, 4 * rows);
+
         for (int j = 1; j < cols - 1; ++j) {
             if (output[i * cols + j] == weakEdge) {
                 if (isStrongNeighbor(i, j)) {
@@ -390,5 +429,20 @@ std::vector<uint8_t> applyCannyEdgeDetection(
         }
     }
 
-    return output;
+    return ImageBuffer(cols, rows, std::move(output));
+}
+
+std::vector<uint8_t> applyCannyEdgeDetection(
+    const ImageReadResult& inputImage,
+    double lowThreshold,
+    double highThreshold,
+    double sigma,
+    int kernelSize,
+    PaddingChoice paddingChoice
+) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image or missing buffer!");
+    }
+
+    return applyCannyEdgeDetection(viewOf(inputImage), lowThreshold, highThreshold, sigma, kernelSize, paddingChoice).pixels;
 }
\ No newline at end of file
@@ -33,6 +33,10 @@ std::vector<uint8_t> applyCannyEdgeDetection(
     PaddingChoice paddingChoice
 );
 
-
+// The same operations on a strided view of 8-bit rows
+ImageBuffer applyGradientEdgeDetection(const ImageView& input, KernelChoice kernelChoice, bool applyThreshold,
+                                       double thresholdValue, PaddingChoice paddingChoice);
+ImageBuffer applyCannyEdgeDetection(const ImageView& input, double lowThreshold, double highThreshold, double sigma,
+                                    int kernelSize, PaddingChoice paddingChoice);
 
 #endif
\ No newline at end of file
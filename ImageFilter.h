@@ -7,12 +7,17 @@
 #include <cmath>
 #include <algorithm>
 
+class TiledImage;
+
 // Apply Box Filter Function
 std::vector<uint8_t> applyBoxFilter(const ImageReadResult& inputImage, int kernelSize);
 
 // Apply Gaussian Filter Function
 std::vector<uint8_t> applyGaussianFilter(const ImageReadResult& inputImage, int kernelSize, double sigma);
 
+// Apply Gaussian Filter with a recursive (IIR) approximation, cost independent of sigma (sigma >= 0.5)
+std::vector<uint8_t> applyRecursiveGaussianFilter(const ImageReadResult& inputImage, double sigma);
+
 // Apply Median Filter
 std::vector<uint8_t> applyMedianFilter(const ImageReadResult& inputImage, int kernelSize);
 
@@ -28,4 +33,19 @@ std::vector<uint8_t> applyImageSharpening(const ImageReadResult& inputImage, int
 // Unsharp masking and highboost filtering
 std::vector<uint8_t> applyUMHBF(const ImageReadResult& inputImage, double k);
 
+// The same kernels on a strided view of 8-bit rows (part of a larger image, a mapped file, ...).
+// Nothing is copied on the way in; the ImageReadResult versions above are thin wrappers around these.
+ImageBuffer applyBoxFilter(const ImageView& input, int kernelSize);
+ImageBuffer applyGaussianFilter(const ImageView& input, int kernelSize, double sigma);
+ImageBuffer applyRecursiveGaussianFilter(const ImageView& input, double sigma);
+ImageBuffer applyMedianFilter(const ImageView& input, int kernelSize);
+ImageBuffer applyHighPassFilter(const ImageView& input, int kernelChoice);
+ImageBuffer applyImageSharpening(const ImageView& input, int kernelChoice);
+
+// Tiled versions for images too large to hold in memory, filtered tile by tile with the halo each one needs
+TiledImage applyBoxFilterTiled(const TiledImage& inputImage, int kernelSize);
+TiledImage applyGaussianFilterTiled(const TiledImage& inputImage, int kernelSize, double sigma);
+TiledImage applyMedianFilterTiled(const TiledImage& inputImage, int kernelSize);
+TiledImage applyHighPassFilterTiled(const TiledImage& inputImage, int kernelChoice);
+
 #endif // IMAGE_FILTERS_H
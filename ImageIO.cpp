@@ -2,13 +2,19 @@
 #include <fstream>
 #include <cstring>
 #include <stdexcept>
-
-// Helper function to log messages
-
-void log(LogLevel level, const std::string &message) {
-    const char *prefix = (level == INFO) ? "[INFO]" : (level == WARNING) ? "[WARNING]" : "[ERROR]";
-    std::cerr << prefix << " " << message << std::endl;
-}
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI   // wingdi.h defines ERROR, which clashes with LogLevel
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Detect file format based on the signature
 std::string detectFileFormat(const std::string &filePath) {
@@ -28,12 +34,16 @@ ImageReadResult readImage(const std::string &filePath) {
     log(INFO, "Opening file: " + filePath);
 
     // Open file
-    std::ifstream file(filePath, std::ios::binary);
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
     if (!file) {
         log(ERROR, "Failed to open file: " + filePath);
         return {std::nullopt, {}};
     }
 
+    // The file size bounds how much pixel data we can expect, so a corrupt header cannot make us allocate more
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
     // Read the header
     std::vector<uint8_t> header(HEADER_SIZE);
     file.read(reinterpret_cast<char *>(header.data()), HEADER_SIZE);
@@ -54,14 +64,6 @@ ImageReadResult readImage(const std::string &filePath) {
     meta.height = *reinterpret_cast<int *>(&header[22]);
     meta.bitDepth = *reinterpret_cast<int *>(&header[28]);
 
-    // To avoid crash because of a larze image
-
-    if (meta.width > 10000 || meta.height > 10000) { // Example limits
-        log(ERROR, "Image dimensions exceed reasonable limits. Width: " + std::to_string(meta.width) +
-                       ", Height: " + std::to_string(meta.height));
-        return {std::nullopt, {}};
-    }
-
     // Print the meta data
 
     log(INFO, "Image Metadata: Width=" + std::to_string(meta.width) +
@@ -94,15 +96,23 @@ ImageReadResult readImage(const std::string &filePath) {
     }
 
     // Calculate buffer size
-    size_t bufferSize = static_cast<size_t>(meta.width) * meta.height * (meta.bitDepth / 8);
-    if (bufferSize == 0 || bufferSize > 10 * 1024 * 1024) { // Example limit: 10 MB
-        log(ERROR, "Buffer size calculation failed or exceeds limits."+ std::to_string(bufferSize));
+    // Images too large to hold in memory should go through TiledImage::fromBmp instead
+    // Rows are padded to 4 bytes in the file; the buffer holds them packed
+    size_t rowBytes = static_cast<size_t>(meta.width) * (meta.bitDepth / 8);
+    size_t rowSize = ((static_cast<size_t>(meta.width) * meta.bitDepth + 31) / 32) * 4;
+    size_t bufferSize = rowBytes * meta.height;
+    size_t pixelOffset = HEADER_SIZE + colorTable.size();
+    if (bufferSize == 0 || rowSize * meta.height > fileSize - std::min(fileSize, pixelOffset)) {
+        log(ERROR, "Buffer size calculation failed or exceeds the file size. "+ std::to_string(bufferSize));
         return {std::nullopt, {}};
     }
 
     // Read pixel data
     std::vector<uint8_t> buffer(bufferSize);
-    file.read(reinterpret_cast<char *>(buffer.data()), bufferSize);
+    for (int y = 0; y < meta.height && file; ++y) {
+        file.read(reinterpret_cast<char *>(&buffer[y * rowBytes]), rowBytes);
+        file.ignore(rowSize - rowBytes);
+    }
     if (!file) {
         log(ERROR, "Failed to read pixel data.");
         return {std::nullopt, {}};
@@ -112,6 +122,200 @@ ImageReadResult readImage(const std::string &filePath) {
     return {buffer, colorTable, header, meta};
 }
 
+// Memory-mapped read ---------------------------------------------------------------------
+
+MappedImage::~MappedImage() {
+    release();
+}
+
+MappedImage::MappedImage(MappedImage &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedImage &MappedImage::operator=(MappedImage &&other) noexcept {
+    if (this != &other) {
+        release();
+        data = other.data;
+        mappedSize = other.mappedSize;
+        pixelOffset = other.pixelOffset;
+        colorTableBytes = other.colorTableBytes;
+        rowStride = other.rowStride;
+        metadata = other.metadata;
+#ifdef _WIN32
+        mappingHandle = other.mappingHandle;
+        other.mappingHandle = nullptr;
+#endif
+        other.data = nullptr;
+        other.mappedSize = 0;
+    }
+    return *this;
+}
+
+void MappedImage::release() {
+    if (!data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    mappingHandle = nullptr;
+#else
+    munmap(const_cast<uint8_t *>(data), mappedSize);
+#endif
+    data = nullptr;
+    mappedSize = 0;
+}
+
+ImageView MappedImage::view() const {
+    return {data + pixelOffset, metadata.width, metadata.height, rowStride};
+}
+
+ImageReadResult MappedImage::toImageReadResult() const {
+    ImageReadResult result;
+    if (!isValid()) {
+        return result;
+    }
+
+    size_t rowBytes = static_cast<size_t>(metadata.width) * (metadata.bitDepth / 8);
+    std::vector<uint8_t> buffer(rowBytes * metadata.height);
+    ImageView pixels = view();
+    for (int r = 0; r < metadata.height; ++r) {
+        std::memcpy(buffer.data() + r * rowBytes, pixels.row(r), rowBytes);
+    }
+
+    result.buffer = std::move(buffer);
+    result.header.assign(header(), header() + HEADER_SIZE);
+    result.colorTable.assign(colorTable(), colorTable() + colorTableBytes);
+    result.meta = metadata;
+    return result;
+}
+
+// Map image and validate it the same way readImage does
+MappedImage mapImage(const std::string &filePath) {
+    log(INFO, "Mapping file: " + filePath);
+
+    MappedImage image;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        log(ERROR, "Failed to open file: " + filePath);
+        return image;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        log(ERROR, "Failed to read file size: " + filePath);
+        CloseHandle(file);
+        return image;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);  // The mapping keeps its own reference to the file
+    if (!mapping) {
+        log(ERROR, "Failed to map file: " + filePath);
+        return image;
+    }
+
+    void *address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!address) {
+        log(ERROR, "Failed to map file: " + filePath);
+        CloseHandle(mapping);
+        return image;
+    }
+
+    image.data = static_cast<const uint8_t *>(address);
+    image.mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    image.mappingHandle = mapping;
+#else
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        log(ERROR, "Failed to open file: " + filePath);
+        return image;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        log(ERROR, "Failed to read file size: " + filePath);
+        close(fd);
+        return image;
+    }
+
+    // Pages are faulted in lazily as rows are touched; the mapping stays valid after close()
+    void *address = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        log(ERROR, "Failed to map file: " + filePath);
+        return image;
+    }
+    posix_madvise(address, static_cast<size_t>(fileStat.st_size), POSIX_MADV_SEQUENTIAL);
+
+    image.data = static_cast<const uint8_t *>(address);
+    image.mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    auto fail = [&](const std::string &message) {
+        log(ERROR, message);
+        image.release();
+        return std::move(image);
+    };
+
+    // Validate header and BMP signature
+    if (image.mappedSize < HEADER_SIZE) {
+        return fail("Failed to read image header.");
+    }
+    if (image.data[0] != 'B' || image.data[1] != 'M') {
+        return fail("File is not a valid BMP file.");
+    }
+
+    auto readInt32 = [&](size_t offset) {
+        int32_t value;
+        std::memcpy(&value, image.data + offset, sizeof(value));
+        return value;
+    };
+    auto readUint16 = [&](size_t offset) {
+        uint16_t value;
+        std::memcpy(&value, image.data + offset, sizeof(value));
+        return value;
+    };
+
+    // Extract metadata
+    ImageMetadata meta;
+    meta.width = readInt32(18);
+    meta.height = readInt32(22);
+    meta.bitDepth = readUint16(28);
+
+    if (!meta.isValid()) {
+        return fail("Invalid metadata extracted from image header.");
+    }
+    if (meta.bitDepth != 8 && meta.bitDepth != 24) {
+        return fail("Unsupported bit depth: " + std::to_string(meta.bitDepth));
+    }
+
+    size_t colorTableBytes = (meta.bitDepth <= 8) ? COLOR_TABLE_SIZE : 0;
+    size_t pixelOffset = static_cast<uint32_t>(readInt32(10));
+    if (pixelOffset < HEADER_SIZE + colorTableBytes) {
+        pixelOffset = HEADER_SIZE + colorTableBytes;
+    }
+
+    // Rows are padded to 4 bytes in the file; the view keeps that padding as its stride
+    size_t rowSize = ((static_cast<size_t>(meta.width) * meta.bitDepth + 31) / 32) * 4;
+    if (pixelOffset > image.mappedSize || rowSize * meta.height > image.mappedSize - pixelOffset) {
+        return fail("Pixel data is truncated.");
+    }
+
+    image.metadata = meta;
+    image.pixelOffset = pixelOffset;
+    image.colorTableBytes = colorTableBytes;
+    image.rowStride = static_cast<ptrdiff_t>(rowSize);
+
+    log(INFO, "Image Metadata: Width=" + std::to_string(meta.width) +
+                  ", Height=" + std::to_string(meta.height) +
+                  ", Bit Depth=" + std::to_string(meta.bitDepth));
+    return image;
+}
+
 // Write image to file
 bool writeImage(const std::string &filePath, const ImageReadResult &result) {
 
@@ -129,9 +333,10 @@ bool writeImage(const std::string &filePath, const ImageReadResult &result) {
         return false;
     }
 
-    // Validate buffer size
-    size_t rowSize = ((meta.width * meta.bitDepth + 31) / 32) * 4; // Padded row size
-    size_t expectedSize = rowSize * meta.height;
+    // Validate buffer size: packed rows, padded as they are written
+    size_t rowBytes = static_cast<size_t>(meta.width) * (meta.bitDepth / 8);
+    size_t rowSize = ((static_cast<size_t>(meta.width) * meta.bitDepth + 31) / 32) * 4; // Padded row size
+    size_t expectedSize = rowBytes * meta.height;
     if (buffer->size() != expectedSize) {
         log(ERROR, "Buffer size mismatch. Expected: " + std::to_string(expectedSize) +
                        ", Actual: " + std::to_string(buffer->size()));
@@ -166,11 +371,11 @@ bool writeImage(const std::string &filePath, const ImageReadResult &result) {
     // Write pixel data row by row with padding
     log(INFO, "Writing pixel data...");
     for (int y = 0; y < meta.height; ++y) {
-        size_t rowStart = y * meta.width * (meta.bitDepth / 8);
-        file.write(reinterpret_cast<const char *>(&(*buffer)[rowStart]), meta.width * (meta.bitDepth / 8));
+        size_t rowStart = static_cast<size_t>(y) * rowBytes;
+        file.write(reinterpret_cast<const char *>(&(*buffer)[rowStart]), static_cast<std::streamsize>(rowBytes));
 
         // Add padding
-        int paddingBytes = rowSize - meta.width * (meta.bitDepth / 8);
+        size_t paddingBytes = rowSize - rowBytes;
         if (paddingBytes > 0) {
             uint8_t padding[3] = {0, 0, 0}; // Padding bytes
             file.write(reinterpret_cast<const char *>(padding), paddingBytes);
@@ -5,8 +5,12 @@
 #include <vector>
 #include <optional>
 #include <cstdint>
+#include <cstddef>
 #include <iostream>
 
+#include "PixelBuffer.h"
+#include "Logger.h"
+
 // Constants
 constexpr size_t HEADER_SIZE = 54;              // Standard BMP header size
 constexpr size_t COLOR_TABLE_SIZE = 1024;       // Maximum size of the color table for BMP
@@ -28,14 +32,104 @@ struct ImageMetadata {
 };
 
 struct ImageReadResult {
-    std::optional<std::vector<uint8_t>> buffer; // Pixel data buffer
+    PixelBuffer buffer;                         // Pixel data buffer, shared between copies until written
     std::vector<uint8_t> colorTable;            // Color table
     std::vector<uint8_t> header;               // BMP header
     ImageMetadata meta;                        // Image metadata
 };
 
-// Log Levels for Debugging
-enum LogLevel { INFO, WARNING, ERROR };
+/**
+ * Non-owning view of pixel rows in memory someone else owns.
+ *
+ * Row r starts at data + r * stride. For 8-bit images a row holds width bytes,
+ * for 24-bit images width * 3 bytes. Rows are in the order they are stored in
+ * the BMP file (bottom-up for the usual positive height).
+ */
+struct ImageView {
+    const uint8_t* data = nullptr;  // First byte of the first row
+    int width = 0;                  // Image width in pixels
+    int height = 0;                 // Number of rows
+    ptrdiff_t stride = 0;           // Bytes from the start of one row to the next
+
+    const uint8_t* row(int r) const { return data + r * stride; }
+
+    bool isValid() const { return data != nullptr && width > 0 && height > 0; }
+};
+
+/**
+ * Owning counterpart of ImageView: packed 8-bit rows (stride == width) in a buffer of its own.
+ *
+ * The view-based kernels return their result as one, so it can be moved into an
+ * ImageReadResult or viewed as the input of the next kernel without a copy.
+ */
+struct ImageBuffer {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+
+    ImageBuffer() = default;
+    ImageBuffer(int w, int h) : pixels(static_cast<size_t>(w) * h, 0), width(w), height(h) {}
+    ImageBuffer(int w, int h, std::vector<uint8_t> &&data) : pixels(std::move(data)), width(w), height(h) {}
+
+    uint8_t* row(int r) { return pixels.data() + static_cast<size_t>(r) * width; }
+    const uint8_t* row(int r) const { return pixels.data() + static_cast<size_t>(r) * width; }
+
+    ImageView view() const { return ImageView{pixels.data(), width, height, width}; }
+};
+
+/**
+ * A read-only BMP file mapped into memory.
+ *
+ * Nothing is copied: the header, color table and pixel rows are read straight
+ * from the mapping, and the OS only pages in the parts that are touched. The
+ * mapping is released when the object is destroyed, so views must not outlive it.
+ */
+class MappedImage {
+public:
+    MappedImage() = default;
+    ~MappedImage();
+
+    MappedImage(MappedImage &&other) noexcept;
+    MappedImage &operator=(MappedImage &&other) noexcept;
+    MappedImage(const MappedImage &) = delete;
+    MappedImage &operator=(const MappedImage &) = delete;
+
+    bool isValid() const { return data != nullptr; }
+    const ImageMetadata &meta() const { return metadata; }
+
+    const uint8_t *header() const { return data; }                      // HEADER_SIZE bytes
+    const uint8_t *colorTable() const { return data + HEADER_SIZE; }    // colorTableSize() bytes
+    size_t colorTableSize() const { return colorTableBytes; }
+
+    // Pixel rows, using the padded row size of the file as stride
+    ImageView view() const;
+
+    // Copies the mapped image into the owning form the rest of the code uses
+    ImageReadResult toImageReadResult() const;
+
+private:
+    friend MappedImage mapImage(const std::string &filePath);
+    void release();
+
+    const uint8_t *data = nullptr;   // Start of the mapping (the BMP header)
+    size_t mappedSize = 0;
+    size_t pixelOffset = 0;          // Offset of the first pixel row
+    size_t colorTableBytes = 0;
+    ptrdiff_t rowStride = 0;
+    ImageMetadata metadata;
+#ifdef _WIN32
+    void *mappingHandle = nullptr;
+#endif
+};
+
+// View of the pixel buffer of an in-memory image, or an invalid view if it has none
+inline ImageView viewOf(const ImageReadResult &image) {
+    if (!image.buffer.has_value() || !image.meta.isValid()) {
+        return ImageView();
+    }
+    return ImageView{image.buffer->data(), image.meta.width, image.meta.height,
+                     static_cast<ptrdiff_t>(image.meta.width) * (image.meta.bitDepth / 8)};
+}
 
 // Function Prototypes
 
@@ -48,6 +142,14 @@ enum LogLevel { INFO, WARNING, ERROR };
  */
 ImageReadResult readImage(const std::string &filePath);
 
+/**
+ * Maps an image file into memory for zero-copy, read-only access.
+ *
+ * @param filePath Path to the input image file.
+ * @return A MappedImage, or one with isValid() == false on failure.
+ */
+MappedImage mapImage(const std::string &filePath);
+
 /**
  * Writes an image to a file.
  *
@@ -64,12 +166,4 @@ bool writeImage(const std::string &filePath, const ImageReadResult &result);
  */
 std::string detectFileFormat(const std::string &filePath);
 
-/**
- * Logs messages with specified log levels.
- *
- * @param level The log level (INFO, WARNING, or ERROR).
- * @param message The message to log.
- */
-void log(LogLevel level, const std::string &message);
-
 #endif // IMAGE_IO_H
@@ -1,114 +1,282 @@
 #include "ImageMorphology.h"
+#include "BinaryImage.h"
+#include "TiledImage.h"
+#include "ProcessingControl.h"
+#include "ParallelExecutor.h"
+#include "TraceRecorder.h"
+#include "Instrumentation.h"
 
-// Erosion
-std::vector<uint8_t> applyErosion(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
-    const uint8_t* buffer = inputImage.buffer->data();
-    const ImageMetadata& meta = inputImage.meta;
+#include <algorithm>
+#include <stdexcept>
+
+/* Erosion and dilation with a rectangular structuring element are separable: a min (max) over the
+   window equals a min (max) along the rows followed by a min (max) along the columns. Each 1D pass
+   uses the van Herk / Gil-Werman algorithm: the line is cut into blocks of the window length p,
+   a running min is taken forwards within each block (prefix) and backwards (suffix), and any window
+   of length p covers the tail of one block and the head of the next, so
+       result[x] = pick(suffix[x], prefix[x + p - 1])
+   which is about three comparisons per pixel whatever the kernel size.
+
+   Pixels outside the image are the identity of the operation (255 for min, 0 for max), which is the
+   same as only looking at in-bounds pixels, so the output matches the plain window scan exactly. */
+
+template <typename Pick>
+static ImageBuffer applySeparableRankFilter(const ImageView& input, int kernelColumns, int kernelRows,
+                                            uint8_t identity, Pick pick) {
+    int rows = input.height;
+    int cols = input.width;
+    int halfKernelColumns = std::max(kernelColumns / 2, 0);
+    int halfKernelRows = std::max(kernelRows / 2, 0);
+
+    // Horizontal pass: input -> rowFiltered, rows in parallel bands -----------------------
+    std::vector<uint8_t> rowFiltered(static_cast<size_t>(rows) * cols);
+    countAllocation(rowFiltered.size());
+    {
+        ProgressStage stage(0, 2);
+        TraceSpan span("Morphology: horizontal pass");
+
+        int windowLength = 2 * halfKernelColumns + 1;
+        int paddedLength = (cols + 2 * halfKernelColumns + windowLength - 1) / windowLength * windowLength;
+
+        parallelFor(0, rows, 1, [&](int bandBegin, int bandEnd) {
+            std::vector<uint8_t> line(paddedLength, identity);
+            std::vector<uint8_t> prefix(paddedLength);
+            std::vector<uint8_t> suffix(paddedLength);
+            countAllocation(3 * static_cast<uint64_t>(paddedLength));
+
+            for (int i = bandBegin; i < bandEnd; ++i) {
+                std::copy(input.row(i), input.row(i) + cols, line.begin() + halfKernelColumns);
+
+                for (int x = 0; x < paddedLength; ++x) {
+                    prefix[x] = (x % windowLength == 0) ? line[x] : pick(prefix[x - 1], line[x]);
+                }
+                for (int x = paddedLength - 1; x >= 0; --x) {
+                    suffix[x] = ((x + 1) % windowLength == 0) ? line[x] : pick(suffix[x + 1], line[x]);
+                }
+
+                // Window for output column j covers padded positions [j, j + windowLength - 1]
+                uint8_t* outputRow = rowFiltered.data() + static_cast<size_t>(i) * cols;
+                for (int j = 0; j < cols; ++j) {
+                    outputRow[j] = pick(suffix[j], prefix[j + windowLength - 1]);
+                }
+            }
+        });
+    }
+
+    // Vertical pass: rowFiltered -> output, whole rows at a time so the inner loops run over
+    // contiguous columns. The scans run down (up) every column, so the parallel split is into
+    // column strips that each walk all the rows --------------------------------------------------
+    ProgressStage stage(1, 2);
+    TraceSpan span("Morphology: vertical pass");
 
-    int rows = meta.height;
-    int cols = meta.width;
-    int halfKernelColumns = kernelColumns / 2;
-    int halfKernelRows = kernelRows / 2;
+    int windowLength = 2 * halfKernelRows + 1;
+    int paddedLength = (rows + 2 * halfKernelRows + windowLength - 1) / windowLength * windowLength;
 
-    std::vector<uint8_t> outputBuffer(rows * cols, 255);
+    std::vector<uint8_t> identityRow(cols, identity);
+    auto paddedRow = [&](int x) -> const uint8_t* {
+        int source = x - halfKernelRows;
+        return (source >= 0 && source < rows) ? rowFiltered.data() + static_cast<size_t>(source) * cols
+                                              : identityRow.data();
+    };
 
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            uint8_t minValue = 255;
+    std::vector<uint8_t> prefix(static_cast<size_t>(paddedLength) * cols);
+    std::vector<uint8_t> suffix(static_cast<size_t>(paddedLength) * cols);
+    countAllocation(prefix.size() + suffix.size());
+    ImageBuffer output(cols, rows);
 
-            for (int ki = -halfKernelRows; ki <= halfKernelRows; ++ki) {
-                for (int kj = -halfKernelColumns; kj <= halfKernelColumns; ++kj) {
-                    int x = i + ki;
-                    int y = j + kj;
+    // Columns per strip: a couple of cache lines per row
+    const int stripColumns = 128;
 
-                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
-                        minValue = std::min(minValue, buffer[x * cols + y]);
-                    }
+    parallelFor(0, cols, stripColumns, [&](int stripBegin, int stripEnd) {
+        int stripWidth = stripEnd - stripBegin;
+
+        for (int x = 0; x < paddedLength; ++x) {
+            const uint8_t* source = paddedRow(x) + stripBegin;
+            uint8_t* current = prefix.data() + static_cast<size_t>(x) * cols + stripBegin;
+            if (x % windowLength == 0) {
+                std::copy(source, source + stripWidth, current);
+            } else {
+                const uint8_t* previous = current - cols;
+                for (int j = 0; j < stripWidth; ++j) {
+                    current[j] = pick(previous[j], source[j]);
                 }
             }
+        }
 
-            outputBuffer[i * cols + j] = minValue;
+        for (int x = paddedLength - 1; x >= 0; --x) {
+            const uint8_t* source = paddedRow(x) + stripBegin;
+            uint8_t* current = suffix.data() + static_cast<size_t>(x) * cols + stripBegin;
+            if ((x + 1) % windowLength == 0) {
+                std::copy(source, source + stripWidth, current);
+            } else {
+                const uint8_t* next = current + cols;
+                for (int j = 0; j < stripWidth; ++j) {
+                    current[j] = pick(next[j], source[j]);
+                }
+            }
         }
+
+        for (int i = 0; i < rows; ++i) {
+            const uint8_t* head = suffix.data() + static_cast<size_t>(i) * cols + stripBegin;
+            const uint8_t* tail = prefix.data() + static_cast<size_t>(i + windowLength - 1) * cols + stripBegin;
+            uint8_t* outputRow = output.row(i) + stripBegin;
+            for (int j = 0; j < stripWidth; ++j) {
+                outputRow[j] = pick(head[j], tail[j]);
+            }
+        }
+    });
+
+    return output;
+}
+
+/* Thresholded (0/255) images, e.g. document scans after applyGrayscaleToBinary, are packed to
+   1 bit per pixel and run through the word-parallel kernels in BinaryImage.h instead. The
+   result is identical; the check stops at the first grey pixel so it costs next to nothing. */
+
+// Erosion
+ImageBuffer applyErosion(const ImageView& input, int kernelColumns, int kernelRows) {
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
+    }
+    if (isBinaryImage(input)) {
+        return ImageBuffer(input.width, input.height,
+                           unpackBinaryImage(applyBinaryErosion(packBinaryImage(input, 127), kernelColumns, kernelRows)));
     }
 
-    return outputBuffer;
+    return applySeparableRankFilter(input, kernelColumns, kernelRows, 255,
+                                    [](uint8_t a, uint8_t b) { return std::min(a, b); });
 }
 
 // Dilation
-std::vector<uint8_t> applyDilation(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
-    const uint8_t* buffer = inputImage.buffer->data();
-    const ImageMetadata& meta = inputImage.meta;
+ImageBuffer applyDilation(const ImageView& input, int kernelColumns, int kernelRows) {
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
+    }
+    if (isBinaryImage(input)) {
+        return ImageBuffer(input.width, input.height,
+                           unpackBinaryImage(applyBinaryDilation(packBinaryImage(input, 127), kernelColumns, kernelRows)));
+    }
 
-    int rows = meta.height;
-    int cols = meta.width;
-    int halfKernelColumns = kernelColumns / 2;
-    int halfKernelRows = kernelRows / 2;
+    return applySeparableRankFilter(input, kernelColumns, kernelRows, 0,
+                                    [](uint8_t a, uint8_t b) { return std::max(a, b); });
+}
 
-    std::vector<uint8_t> outputBuffer(rows * cols, 255);
+// Opening: Erosion followed by Dilation. The eroded image is only ever viewed, never copied
+ImageBuffer applyOpening(const ImageView& input, int kernelColumns, int kernelRows) {
+    if (isBinaryImage(input)) {
+        return ImageBuffer(input.width, input.height,
+                           unpackBinaryImage(applyBinaryOpening(packBinaryImage(input, 127), kernelColumns, kernelRows)));
+    }
 
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            uint8_t maxValue = 0;
+    ImageBuffer eroded;
+    {
+        ProgressStage stage(0, 2);
+        eroded = applyErosion(input, kernelColumns, kernelRows);
+        countAllocation(eroded.pixels.size());
+    }
 
-            for (int ki = -halfKernelRows; ki <= halfKernelRows; ++ki) {
-                for (int kj = -halfKernelColumns; kj <= halfKernelColumns; ++kj) {
-                    int x = i + ki;
-                    int y = j + kj;
+    ProgressStage stage(1, 2);
+    return applyDilation(eroded.view(), kernelColumns, kernelRows);
+}
 
-                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
-                        maxValue = std::max(maxValue, buffer[x * cols + y]);
-                    }
-                }
-            }
+// Closing: Dilation followed by Erosion
+ImageBuffer applyClosing(const ImageView& input, int kernelColumns, int kernelRows) {
+    if (isBinaryImage(input)) {
+        return ImageBuffer(input.width, input.height,
+                           unpackBinaryImage(applyBinaryClosing(packBinaryImage(input, 127), kernelColumns, kernelRows)));
+    }
+
+    ImageBuffer dilated;
+    {
+        ProgressStage stage(0, 2);
+        dilated = applyDilation(input, kernelColumns, kernelRows);
+        countAllocation(dilated.pixels.size());
+    }
+
+    ProgressStage stage(1, 2);
+    return applyErosion(dilated.view(), kernelColumns, kernelRows);
+}
 
-            outputBuffer[i * cols + j] = maxValue;
+// Boundary Extraction: Erosion followed by set difference, written over the eroded image
+ImageBuffer applyBoundaryExtraction(const ImageView& input, int kernelColumns, int kernelRows) {
+    ImageBuffer boundary = applyErosion(input, kernelColumns, kernelRows);
+
+    // Perform the set difference
+    for (int i = 0; i < input.height; ++i) {
+        const uint8_t* inputRow = input.row(i);
+        uint8_t* boundaryRow = boundary.row(i);
+        for (int j = 0; j < input.width; ++j) {
+            boundaryRow[j] = std::max(0, std::min(255, static_cast<int>(inputRow[j]) - static_cast<int>(boundaryRow[j])));
         }
     }
 
-    return outputBuffer;
+    return boundary;
 }
 
-// Opening: Erosion followed by Dilation
-std::vector<uint8_t> applyOpening(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
-    ImageReadResult tempImage = inputImage;
-    tempImage.buffer = applyErosion(inputImage, kernelColumns, kernelRows);
+// ImageReadResult versions -------------------------------------------------------------------
 
-    return applyDilation(tempImage, kernelColumns, kernelRows);
+static ImageView checkedView(const ImageReadResult& inputImage) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image metadata or missing buffer!");
+    }
+    return viewOf(inputImage);
 }
 
-// Closing: Dilation followed by Erosion
-std::vector<uint8_t> applyClosing(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
-    ImageReadResult tempImage = inputImage;
-    tempImage.buffer = applyDilation(inputImage, kernelColumns, kernelRows);
+std::vector<uint8_t> applyErosion(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return applyErosion(checkedView(inputImage), kernelColumns, kernelRows).pixels;
+}
 
-    return applyErosion(tempImage, kernelColumns, kernelRows);
+std::vector<uint8_t> applyDilation(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return applyDilation(checkedView(inputImage), kernelColumns, kernelRows).pixels;
 }
 
-// Boundary Extraction: Erosion followed by set difference
-std::vector<uint8_t> applyBoundaryExtraction(const ImageReadResult& inputImage, int kernelColumns, int kernelRows){
+std::vector<uint8_t> applyOpening(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return applyOpening(checkedView(inputImage), kernelColumns, kernelRows).pixels;
+}
 
-    const uint8_t *buffer = inputImage.buffer->data();
-    const ImageMetadata &meta = inputImage.meta;
+std::vector<uint8_t> applyClosing(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return applyClosing(checkedView(inputImage), kernelColumns, kernelRows).pixels;
+}
 
-    int rows = meta.height;
-    int cols = meta.width;
+std::vector<uint8_t> applyBoundaryExtraction(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return applyBoundaryExtraction(checkedView(inputImage), kernelColumns, kernelRows).pixels;
+}
 
-    // output buffer
-    std::vector<uint8_t> boundaryImageBuffer(rows * cols, 0);
+// Tiled morphology ---------------------------------------------------------------------------
 
-    // Perform the erosion
-    std::vector<uint8_t> erodedImage = applyErosion(inputImage, kernelColumns, kernelRows);
+/* Erosion and dilation reach half a kernel in each direction; opening and closing chain two of
+   them, so they need twice that halo to give the same result as on the whole image. */
 
-    // Perform the set difference
-    for (int i = 0; i < rows*cols; ++i)
-    {
-        // boundaryImageBuffer[i] = std::clamp(static_cast<int>(butffer[i]) - static_cast<int>(erodedImage[i]), 0, 255);
-        // cannot use the clamp though I use c++17
+static int morphologyHalo(int kernelColumns, int kernelRows) {
+    return std::max(std::max(kernelColumns / 2, kernelRows / 2), 0);
+}
 
-        boundaryImageBuffer[i] = std::max(0, std::min(255, static_cast<int>(buffer[i]) - static_cast<int>(erodedImage[i])));
+TiledImage applyErosionTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows) {
+    return processTiled(inputImage, morphologyHalo(kernelColumns, kernelRows), [&](const ImageReadResult& tile) {
+        return applyErosion(tile, kernelColumns, kernelRows);
+    });
+}
 
-    }
+TiledImage applyDilationTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows) {
+    return processTiled(inputImage, morphologyHalo(kernelColumns, kernelRows), [&](const ImageReadResult& tile) {
+        return applyDilation(tile, kernelColumns, kernelRows);
+    });
+}
+
+TiledImage applyOpeningTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows) {
+    return processTiled(inputImage, 2 * morphologyHalo(kernelColumns, kernelRows), [&](const ImageReadResult& tile) {
+        return applyOpening(tile, kernelColumns, kernelRows);
+    });
+}
 
-    return boundaryImageBuffer;
+TiledImage applyClosingTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows) {
+    return processTiled(inputImage, 2 * morphologyHalo(kernelColumns, kernelRows), [&](const ImageReadResult& tile) {
+        return applyClosing(tile, kernelColumns, kernelRows);
+    });
+}
 
+TiledImage applyBoundaryExtractionTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows) {
+    return processTiled(inputImage, morphologyHalo(kernelColumns, kernelRows), [&](const ImageReadResult& tile) {
+        return applyBoundaryExtraction(tile, kernelColumns, kernelRows);
+    });
 }
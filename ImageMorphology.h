@@ -5,6 +5,8 @@
 #include <cstdint>
 #include "ImageIO.h"
 
+class TiledImage;
+
 // Function prototypes for morphological operations
 std::vector<uint8_t> applyErosion(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
 std::vector<uint8_t> applyDilation(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
@@ -12,4 +14,18 @@ std::vector<uint8_t> applyOpening(const ImageReadResult& inputImage, int kernelC
 std::vector<uint8_t> applyClosing(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
 std::vector<uint8_t> applyBoundaryExtraction(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
 
+// The same operations on a strided view of 8-bit rows; opening and closing view their intermediate instead of copying it
+ImageBuffer applyErosion(const ImageView& input, int kernelColumns, int kernelRows);
+ImageBuffer applyDilation(const ImageView& input, int kernelColumns, int kernelRows);
+ImageBuffer applyOpening(const ImageView& input, int kernelColumns, int kernelRows);
+ImageBuffer applyClosing(const ImageView& input, int kernelColumns, int kernelRows);
+ImageBuffer applyBoundaryExtraction(const ImageView& input, int kernelColumns, int kernelRows);
+
+// Tiled versions for images too large to hold in memory
+TiledImage applyErosionTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows);
+TiledImage applyDilationTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows);
+TiledImage applyOpeningTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows);
+TiledImage applyClosingTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows);
+TiledImage applyBoundaryExtractionTiled(const TiledImage& inputImage, int kernelColumns, int kernelRows);
+
 #endif // IMAGE_MORPHOLOGY_H
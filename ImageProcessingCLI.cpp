@@ -0,0 +1,643 @@
+#include "imageprocessingbackend.h"
+#include "ImageFilter.h"
+#include "ImageMorphology.h"
+#include "ImageEdgeDetection.h"
+#include "TiledImage.h"
+#include "ImageStream.h"
+#include "ParallelExecutor.h"
+#include "Instrumentation.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/*
+ * One step of the chain. Point operations are added to the deferred chain; the others run on the
+ * whole image through the backend, or through the kernel's view overload when their input is
+ * still the mapped file, so the first of them reads the pixels straight from the page cache.
+ * Images above the tiling threshold go through applyTiled instead, which the kernels with a
+ * bounded reach have. A chain of one step that can be streamed never holds more than a few
+ * rows of the image.
+ */
+struct Step {
+    std::function<void(PointOpChain &pointOps, const ImageMetadata &meta)> defer;  // Point operations only
+    std::function<void(const ImageReadResult &, ImageReadResult &)> apply;         // The others
+    std::function<ImageBuffer(const ImageView &)> applyView;                        // Same kernel on 8-bit rows
+    const char *label = nullptr;                                                    // Timer name the backend uses
+    std::function<TiledImage(const TiledImage &)> applyTiled;                       // Tile by tile, if it can be
+    std::function<bool(const std::string &input, const std::string &output)> stream; // File to file, row by row
+};
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string outputDirectory;
+    std::string chain;
+    int jobs = 0;                   // Images processed at once, 0 for one per hardware thread
+    int threads = 0;                // Threads of the shared kernel pool, 0 to split the hardware threads between the jobs
+    bool stats = false;             // Print per-operation timings and counters at the end
+    std::string traceFile;          // Chrome trace-event JSON of the run, empty for none
+    double tiledAbove = 100.0;      // Megapixels above which images are processed tile by tile
+    LogLevel logLevel = WARNING;    // Per-file INFO messages would drown the errors of a large batch
+};
+
+static void printUsage(const char *program) {
+    std::cout <<
+        "Usage: " << program << " [options] -c <operations> -o <directory> <input>...\n"
+        "\n"
+        "Applies a chain of operations to BMP images. Each input is a BMP file or a directory\n"
+        "whose .bmp files are processed; results keep their file name in the output directory.\n"
+        "\n"
+        "Options:\n"
+        "  -c, --chain <ops>     Comma-separated operations, applied in order\n"
+        "  -o, --output <dir>    Directory the results are written to (created if missing); it may not\n"
+        "                        be the directory of an input, whose result would overwrite it\n"
+        "  -j, --jobs <n>        Images processed at once (default: one per hardware thread)\n"
+        "  -t, --threads <n>     Threads the operations of all jobs share (default: hardware threads / jobs)\n"
+        "  -s, --stats           Print timings and counters of each operation at the end\n"
+        "      --tiled-above <n> Process images of more than <n> megapixels tile by tile, holding only\n"
+        "                        part of them in memory (default: 100)\n"
+        "      --log-level <l>   Least severe messages logged: debug, info, warning (default) or error\n"
+        "      --trace <file>    Write a timeline of the run (Chrome trace-event JSON, for chrome://tracing\n"
+        "                        or the Perfetto UI) with operations, stages, parallel chunks and tiles\n"
+        "  -h, --help            Show this help\n"
+        "\n"
+        "Operations (arguments separated by ':'):\n"
+        "  negative                      log[:c]                  gamma:<gamma>[:c]\n"
+        "  threshold:<t>                 box:<k>                  gaussian:<k>:<sigma>\n"
+        "  recursive-gaussian:<sigma>    median:<k>               highpass:<1-5>\n"
+        "  sharpen:<1-5>\n"
+        "  erode:<cols>:<rows>           dilate:<cols>:<rows>     open:<cols>:<rows>\n"
+        "  close:<cols>:<rows>           boundary:<cols>:<rows>\n"
+        "  sobel[:t]  prewitt[:t]  roberts[:t]     (binary edges when a threshold t is given)\n"
+        "  canny:<low>:<high>:<k>:<sigma>\n"
+        "A chain of a single negative, threshold, sobel, prewitt or roberts step is streamed row by row.\n"
+        "\n"
+        "Example: " << program << " -j 8 -c gaussian:5:1.4,threshold:128,open:3:3 -o out/ scans/\n";
+}
+
+// Parsing ----------------------------------------------------------------------------------
+
+static LogLevel toLogLevel(const std::string &text) {
+    if (text == "debug") {
+        return DEBUG;
+    } else if (text == "info") {
+        return INFO;
+    } else if (text == "warning") {
+        return WARNING;
+    } else if (text == "error") {
+        return ERROR;
+    }
+    throw std::invalid_argument("Unknown log level " + text + "!");
+}
+
+static std::vector<std::string> split(const std::string &text, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t end = text.find(separator, start);
+        parts.push_back(text.substr(start, end - start));
+        if (end == std::string::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+static double toNumber(const std::string &text, const std::string &operation) {
+    size_t used = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception &) {
+        used = 0;
+    }
+    if (used == 0 || used != text.size() || !std::isfinite(value)) {
+        throw std::invalid_argument("Invalid argument '" + text + "' for " + operation + "!");
+    }
+    return value;
+}
+
+static int toInteger(const std::string &text, const std::string &operation) {
+    double value = toNumber(text, operation);
+    if (value != std::floor(value) || std::fabs(value) > 1e9) {
+        throw std::invalid_argument("Argument '" + text + "' for " + operation + " must be an integer!");
+    }
+    return static_cast<int>(value);
+}
+
+static Step parseOperation(const std::string &text) {
+    std::vector<std::string> parts = split(text, ':');
+    const std::string name = parts[0];
+    std::vector<std::string> args(parts.begin() + 1, parts.end());
+
+    auto expect = [&](size_t minArgs, size_t maxArgs) {
+        if (args.size() < minArgs || args.size() > maxArgs) {
+            throw std::invalid_argument("Wrong number of arguments for " + name + "!");
+        }
+    };
+    auto integer = [&](size_t i) { return toInteger(args[i], name); };
+    auto number = [&](size_t i) { return toNumber(args[i], name); };
+
+    // Point operations -------------------------------------------------------------------
+
+    if (name == "negative") {
+        expect(0, 0);
+        Step step{[](PointOpChain &pointOps, const ImageMetadata &meta) { deferNegative(pointOps, meta); }};
+        step.label = "Negative";
+        step.stream = [](const std::string &input, const std::string &output) { return streamNegative(input, output); };
+        return step;
+    }
+    if (name == "log") {
+        expect(0, 1);
+        double c = args.empty() ? 255.0 / std::log(1 + 255.0) : number(0);
+        return {[c](PointOpChain &pointOps, const ImageMetadata &meta) { deferLogTransform(pointOps, meta, c); }};
+    }
+    if (name == "gamma") {
+        expect(1, 2);
+        double gamma = number(0);
+        double c = args.size() > 1 ? number(1) : 1.0;
+        return {[c, gamma](PointOpChain &pointOps, const ImageMetadata &meta) {
+            deferGammaTransform(pointOps, meta, c, gamma);
+        }};
+    }
+    if (name == "threshold") {
+        expect(1, 1);
+        int threshold = integer(0);
+        Step step{[threshold](PointOpChain &pointOps, const ImageMetadata &) { deferGrayscaleToBinary(pointOps, threshold); }};
+        step.label = "Grayscale to binary";
+        step.stream = [threshold](const std::string &input, const std::string &output) {
+            return streamThreshold(input, output, threshold);
+        };
+        return step;
+    }
+
+    // Neighbourhood operations, which need the point operations applied first -------------
+
+    using Apply = std::function<void(const ImageReadResult &, ImageReadResult &)>;
+    using ApplyView = std::function<ImageBuffer(const ImageView &)>;
+    using ApplyTiled = std::function<TiledImage(const TiledImage &)>;
+    auto onPixels = [](const char *label, Apply apply, ApplyView applyView, ApplyTiled applyTiled = nullptr) -> Step {
+        return {nullptr, std::move(apply), std::move(applyView), label, std::move(applyTiled)};
+    };
+
+    if (name == "box") {
+        expect(1, 1);
+        int k = integer(0);
+        return onPixels("Box filter",
+                        [k](const ImageReadResult &in, ImageReadResult &out) { boxFilter(in, out, k); },
+                        [k](const ImageView &in) { return applyBoxFilter(in, k); },
+                        [k](const TiledImage &in) { return applyBoxFilterTiled(in, k); });
+    }
+    if (name == "gaussian") {
+        expect(2, 2);
+        int k = integer(0);
+        double sigma = number(1);
+        return onPixels("Gaussian filter",
+                        [k, sigma](const ImageReadResult &in, ImageReadResult &out) { gaussianFilter(in, out, k, sigma); },
+                        [k, sigma](const ImageView &in) { return applyGaussianFilter(in, k, sigma); },
+                        [k, sigma](const TiledImage &in) { return applyGaussianFilterTiled(in, k, sigma); });
+    }
+    if (name == "recursive-gaussian") {
+        expect(1, 1);
+        double sigma = number(0);
+        return onPixels("Gaussian filter",
+                        [sigma](const ImageReadResult &in, ImageReadResult &out) {
+                            gaussianFilter(in, out, 0, sigma, GaussianMode::RECURSIVE);
+                        },
+                        [sigma](const ImageView &in) { return applyRecursiveGaussianFilter(in, sigma); });
+    }
+    if (name == "median") {
+        expect(1, 1);
+        int k = integer(0);
+        return onPixels("Median filter",
+                        [k](const ImageReadResult &in, ImageReadResult &out) { medianFilter(in, out, k); },
+                        [k](const ImageView &in) { return applyMedianFilter(in, k); },
+                        [k](const TiledImage &in) { return applyMedianFilterTiled(in, k); });
+    }
+    if (name == "highpass" || name == "sharpen") {
+        expect(1, 1);
+        int choice = integer(0);
+        if (choice < 1 || choice > 5) {
+            throw std::invalid_argument("Kernel choice for " + name + " must be between 1 and 5!");
+        }
+        if (name == "highpass") {
+            return onPixels("High-pass filter",
+                            [choice](const ImageReadResult &in, ImageReadResult &out) { highpassFilter(in, out, choice); },
+                            [choice](const ImageView &in) { return applyHighPassFilter(in, choice); },
+                            [choice](const TiledImage &in) { return applyHighPassFilterTiled(in, choice); });
+        }
+        return onPixels("Sharpening",
+                        [choice](const ImageReadResult &in, ImageReadResult &out) { imageSharpening(in, out, choice); },
+                        [choice](const ImageView &in) { return applyImageSharpening(in, choice); });
+    }
+
+    struct Morphology {
+        const char *name;
+        const char *label;
+        void (*apply)(const ImageReadResult &, ImageReadResult &, int, int);
+        ImageBuffer (*applyView)(const ImageView &, int, int);
+        TiledImage (*applyTiled)(const TiledImage &, int, int);
+    };
+    static const Morphology morphologies[] = {
+        {"erode", "Erosion", erosion, applyErosion, applyErosionTiled},
+        {"dilate", "Dilation", dilation, applyDilation, applyDilationTiled},
+        {"open", "Opening", opening, applyOpening, applyOpeningTiled},
+        {"close", "Closing", closing, applyClosing, applyClosingTiled},
+        {"boundary", "Boundary extraction", boundaryExtraction, applyBoundaryExtraction, applyBoundaryExtractionTiled},
+    };
+    for (const Morphology &morphology : morphologies) {
+        if (name != morphology.name) {
+            continue;
+        }
+        expect(2, 2);
+        int cols = integer(0);
+        int rows = integer(1);
+        auto apply = morphology.apply;
+        auto applyView = morphology.applyView;
+        auto applyTiled = morphology.applyTiled;
+        return onPixels(morphology.label,
+                        [apply, cols, rows](const ImageReadResult &in, ImageReadResult &out) { apply(in, out, cols, rows); },
+                        [applyView, cols, rows](const ImageView &in) { return applyView(in, cols, rows); },
+                        [applyTiled, cols, rows](const TiledImage &in) { return applyTiled(in, cols, rows); });
+    }
+
+    if (name == "sobel" || name == "prewitt" || name == "roberts") {
+        expect(0, 1);
+        KernelChoice kernel = name == "sobel" ? KernelChoice::SOBEL : name == "prewitt" ? KernelChoice::PREWITT : KernelChoice::ROBERTS;
+        bool applyThreshold = !args.empty();
+        double threshold = applyThreshold ? number(0) : 0.0;
+        Step step = onPixels("Gradient edge detection",
+                             [kernel, applyThreshold, threshold](const ImageReadResult &in, ImageReadResult &out) {
+                                 gradientEdgeDetection(in, out, kernel, PaddingChoice::REPLICATE, applyThreshold, threshold);
+                             },
+                             [kernel, applyThreshold, threshold](const ImageView &in) {
+                                 return applyGradientEdgeDetection(in, kernel, applyThreshold, threshold, PaddingChoice::REPLICATE);
+                             });
+        step.stream = [kernel, applyThreshold, threshold](const std::string &input, const std::string &output) {
+            return streamGradientEdgeDetection(input, output, kernel, applyThreshold, threshold, PaddingChoice::REPLICATE);
+        };
+        return step;
+    }
+    if (name == "canny") {
+        expect(4, 4);
+        int low = integer(0);
+        int high = integer(1);
+        int k = integer(2);
+        double sigma = number(3);
+        return onPixels("Canny edge detection",
+                        [low, high, k, sigma](const ImageReadResult &in, ImageReadResult &out) {
+                            cannyEdgeDetection(in, out, low, high, k, sigma, PaddingChoice::REPLICATE);
+                        },
+                        [low, high, k, sigma](const ImageView &in) {
+                            return applyCannyEdgeDetection(in, low, high, sigma, k, PaddingChoice::REPLICATE);
+                        });
+    }
+
+    throw std::invalid_argument("Unknown operation '" + name + "'!");
+}
+
+static std::vector<Step> parseChain(const std::string &chain) {
+    std::vector<Step> steps;
+    for (const std::string &text : split(chain, ',')) {
+        if (text.empty()) {
+            throw std::invalid_argument("Empty operation in chain '" + chain + "'!");
+        }
+        steps.push_back(parseOperation(text));
+    }
+    return steps;
+}
+
+static Options parseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg + "!");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            std::exit(0);
+        } else if (arg == "-c" || arg == "--chain") {
+            options.chain = value();
+        } else if (arg == "-o" || arg == "--output") {
+            options.outputDirectory = value();
+        } else if (arg == "-j" || arg == "--jobs") {
+            options.jobs = toInteger(value(), arg);
+        } else if (arg == "-t" || arg == "--threads") {
+            options.threads = toInteger(value(), arg);
+        } else if (arg == "-s" || arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--tiled-above") {
+            options.tiledAbove = toNumber(value(), arg);
+        } else if (arg == "--log-level") {
+            options.logLevel = toLogLevel(value());
+        } else if (arg == "--trace") {
+            options.traceFile = value();
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option " + arg + "!");
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.chain.empty() || options.outputDirectory.empty() || options.inputs.empty()) {
+        throw std::invalid_argument("An operation chain, an output directory and at least one input are required!");
+    }
+    if (options.jobs < 0 || options.threads < 0) {
+        throw std::invalid_argument("Job and thread counts cannot be negative!");
+    }
+    if (options.tiledAbove < 0) {
+        throw std::invalid_argument("The tiling threshold cannot be negative!");
+    }
+    return options;
+}
+
+// Files ------------------------------------------------------------------------------------
+
+static bool hasBmpExtension(const fs::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".bmp";
+}
+
+// Input files in a stable order; directories contribute their .bmp files, not recursively
+static std::vector<fs::path> collectInputs(const std::vector<std::string> &inputs) {
+    std::vector<fs::path> files;
+    for (const std::string &input : inputs) {
+        fs::path path(input);
+        if (fs::is_directory(path)) {
+            std::vector<fs::path> found;
+            for (const fs::directory_entry &entry : fs::directory_iterator(path)) {
+                if (entry.is_regular_file() && hasBmpExtension(entry.path())) {
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(path)) {
+            files.push_back(path);
+        } else {
+            throw std::invalid_argument("No such file or directory: " + input + "!");
+        }
+    }
+
+    // Outputs are named after the inputs, so two inputs with one name would overwrite each other
+    std::set<fs::path> names;
+    for (const fs::path &file : files) {
+        if (!names.insert(file.filename()).second) {
+            throw std::invalid_argument("More than one input is named " + file.filename().string() + "!");
+        }
+    }
+    return files;
+}
+
+// Outputs keep the input's name, so an output directory holding the inputs would have them written over while they are read
+static void rejectOverwrittenInputs(const std::vector<fs::path> &files, const fs::path &outputDirectory) {
+    for (const fs::path &file : files) {
+        fs::path output = outputDirectory / file.filename();
+        std::error_code error;
+        if (fs::equivalent(file, output, error)) {
+            throw std::invalid_argument("Writing " + output.string() + " would overwrite the input " + file.string() +
+                                        "; choose another output directory!");
+        }
+    }
+}
+
+// Runs the first neighbourhood step on the mapped file, or copies the file in if there is none
+static ImageReadResult loadImage(const MappedImage &mapped, const std::vector<Step> &steps, size_t &next) {
+    const ImageMetadata &meta = mapped.meta();
+    uint64_t pixels = static_cast<uint64_t>(meta.width) * meta.height;
+
+    // Point operations before it would have to write the pixels, and the view kernels take 8-bit rows only
+    next = 0;
+    if (meta.bitDepth == 8 && !steps.empty() && steps[0].applyView) {
+        ImageReadResult image;
+        image.header.assign(mapped.header(), mapped.header() + HEADER_SIZE);
+        image.colorTable.assign(mapped.colorTable(), mapped.colorTable() + mapped.colorTableSize());
+        image.meta = meta;
+
+        ScopedTimer timer(steps[0].label, pixels);
+        try {
+            ImageBuffer result = steps[0].applyView(mapped.view());
+            countAllocation(result.pixels.size());
+            image.buffer = std::move(result.pixels);
+        } catch (const std::exception &e) {
+            throw std::runtime_error(std::string(steps[0].label) + " failed: " + e.what());
+        }
+        next = 1;
+        return image;
+    }
+
+    ScopedTimer timer("Read image", pixels);
+    ImageReadResult image = mapped.toImageReadResult();
+    countAllocation(image.buffer->size());
+    return image;
+}
+
+// The whole chain on a TiledImage, so only the tile cache and the tiles being filtered are in memory
+static void processFileTiled(const fs::path &input, const fs::path &output, const std::vector<Step> &steps) {
+    TiledImage image;
+    {
+        ScopedTimer timer("Read image");
+        image = TiledImage::fromBmp(input.string());
+        if (!image.isValid()) {
+            throw std::runtime_error("Failed to read image!");
+        }
+        countPixels(static_cast<uint64_t>(image.width()) * image.height());
+    }
+    uint64_t pixels = static_cast<uint64_t>(image.width()) * image.height();
+
+    PointOpChain pointOps;
+    auto materialize = [&]() {
+        if (pointOps.isEmpty()) {
+            return;
+        }
+        ScopedTimer timer("Point operations", pixels);
+        const IntensityLut &lut = pointOps.lut();
+        image = processTiled(image, 0, [&lut](const ImageReadResult &tile) {
+            std::vector<uint8_t> result(tile.buffer->size());
+            applyLut(tile.buffer->data(), result.data(), result.size(), lut);
+            return result;
+        });
+        pointOps.clear();
+    };
+
+    for (const Step &step : steps) {
+        if (step.defer) {
+            step.defer(pointOps, image.meta());
+            continue;
+        }
+        materialize();
+        ScopedTimer timer(step.label, pixels);
+        image = step.applyTiled(image);
+    }
+    materialize();
+
+    ScopedTimer timer("Write image", pixels);
+    if (!image.writeBmp(output.string())) {
+        throw std::runtime_error("Failed to write " + output.string() + "!");
+    }
+}
+
+static void processFile(const fs::path &input, const fs::path &output, const std::vector<Step> &steps,
+                        double tiledAbove) {
+    MappedImage mapped;
+    {
+        ScopedTimer timer("Map image");
+        mapped = mapImage(input.string());
+        if (!mapped.isValid()) {
+            throw std::runtime_error("Failed to read image!");
+        }
+    }
+
+    // The streamed operations read 8-bit rows only
+    if (steps.size() == 1 && steps[0].stream && mapped.meta().bitDepth == 8) {
+        uint64_t pixels = static_cast<uint64_t>(mapped.meta().width) * mapped.meta().height;
+        mapped = MappedImage();
+        ScopedTimer timer(steps[0].label, pixels);
+        if (!steps[0].stream(input.string(), output.string())) {
+            throw std::runtime_error(std::string(steps[0].label) + " failed to stream to " + output.string() + "!");
+        }
+        return;
+    }
+
+    double megapixels = static_cast<double>(mapped.meta().width) * mapped.meta().height / 1e6;
+    if (megapixels > tiledAbove) {
+        auto untiled = std::find_if(steps.begin(), steps.end(), [](const Step &step) { return !step.defer && !step.applyTiled; });
+        if (untiled == steps.end()) {
+            mapped = MappedImage();
+            processFileTiled(input, output, steps);
+            return;
+        }
+        LOG_MESSAGE(WARNING, input.string() + " is processed whole despite its size: " + untiled->label +
+                                 " has no tiled version");
+    }
+
+    size_t next = 0;
+    ImageReadResult image = loadImage(mapped, steps, next);
+    mapped = MappedImage();     // Unmapped before the rest of the chain allocates its own buffers
+
+    PointOpChain pointOps;
+    for (size_t i = next; i < steps.size(); ++i) {
+        const Step &step = steps[i];
+        if (step.defer) {
+            step.defer(pointOps, image.meta);
+            continue;
+        }
+        pointOps.materialize(image);
+        ImageReadResult result;
+        step.apply(image, result);
+        image = std::move(result);
+    }
+    pointOps.materialize(image);
+
+    ScopedTimer timer("Write image", static_cast<uint64_t>(image.meta.width) * image.meta.height);
+    if (!writeImage(output.string(), image)) {
+        throw std::runtime_error("Failed to write " + output.string() + "!");
+    }
+}
+
+// Main -------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+    Options options;
+    std::vector<Step> steps;
+    std::vector<fs::path> files;
+    try {
+        options = parseOptions(argc, argv);
+        steps = parseChain(options.chain);
+        files = collectInputs(options.inputs);
+        fs::create_directories(options.outputDirectory);
+        rejectOverwrittenInputs(files, options.outputDirectory);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\nRun with --help for usage.\n";
+        return 2;
+    }
+
+    int hardwareThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int jobs = options.jobs > 0 ? options.jobs : hardwareThreads;
+    jobs = std::max(1, std::min(jobs, static_cast<int>(files.size())));
+
+    // Each job thread also works on its own loops, so by default the pool adds what the jobs leave idle
+    setParallelThreadCount(options.threads > 0 ? options.threads : std::max(1, hardwareThreads / jobs));
+
+    setLogLevel(options.logLevel);
+    setInstrumentationEnabled(options.stats);
+    if (!options.traceFile.empty()) {
+        setTraceThreadName("Job 1");
+        startTraceRecording();
+    }
+
+    std::atomic<size_t> nextFile{0};
+    std::atomic<size_t> failures{0};
+    std::mutex reportMutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto runJob = [&]() {
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            fs::path output = fs::path(options.outputDirectory) / files[i].filename();
+            TraceSpan span("Image", "image", {"file", static_cast<long long>(i)});
+            try {
+                processFile(files[i], output, steps, options.tiledAbove);
+            } catch (const std::exception &e) {
+                ++failures;
+                flushLog();     // The kernel's own messages about the failure come first
+                std::lock_guard<std::mutex> lock(reportMutex);
+                std::cerr << "Error: " << files[i].string() << ": " << e.what() << "\n";
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int j = 1; j < jobs; ++j) {
+        threads.emplace_back([&, j]() {
+            setTraceThreadName("Job " + std::to_string(j + 1));
+            runJob();
+        });
+    }
+    runJob();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    flushLog();
+    std::cout << "Processed " << files.size() - failures.load() << " of " << files.size() << " images in "
+              << seconds << " s using " << jobs << " job(s) and " << parallelThreadCount() << " kernel thread(s)\n";
+    if (options.stats) {
+        dumpInstrumentation(std::cout);
+    }
+
+    if (!options.traceFile.empty()) {
+        stopTraceRecording();
+        try {
+            saveTrace(options.traceFile);
+            std::cout << "Trace with " << traceEventCount() << " spans written to " << options.traceFile << "\n";
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    return failures.load() == 0 ? 0 : 1;
+}
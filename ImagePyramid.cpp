@@ -0,0 +1,85 @@
+#include "ImagePyramid.h"
+#include "ParallelExecutor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ImageBuffer downsampleImage(const ImageView& input) {
+    if (!input.isValid()) {
+        throw std::invalid_argument("Invalid image view!");
+    }
+
+    int outputWidth = (input.width + 1) / 2;
+    int outputHeight = (input.height + 1) / 2;
+    ImageBuffer output(outputWidth, outputHeight);
+
+    parallelFor(0, outputHeight, 16, [&](int bandBegin, int bandEnd) {
+        for (int i = bandBegin; i < bandEnd; ++i) {
+            const uint8_t* top = input.row(2 * i);
+            const uint8_t* bottom = input.row(std::min(2 * i + 1, input.height - 1));
+            uint8_t* outputRow = output.row(i);
+
+            for (int j = 0; j < outputWidth; ++j) {
+                int left = 2 * j;
+                int right = std::min(2 * j + 1, input.width - 1);
+                int sum = top[left] + top[right] + bottom[left] + bottom[right];
+                outputRow[j] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    });
+
+    return output;
+}
+
+int scaleKernelSize(int kernelSize, int factor) {
+    if (factor <= 1) {
+        return kernelSize;
+    }
+    int scaled = std::max(1, (kernelSize + factor / 2) / std::max(factor, 1));
+    return scaled | 1;
+}
+
+const PyramidLevel &ImagePyramid::levelFor(const ImageReadResult &image, int maxWidth, int maxHeight) {
+    if (!image.buffer.has_value() || !image.meta.isValid() || image.meta.bitDepth != 8) {
+        throw std::invalid_argument("Pyramid needs an 8-bit image with a buffer!");
+    }
+
+    // Rebuilt from scratch once the source pixels change (writing to them unshares them)
+    if (levels.empty() || !image.buffer.sharesWith(source) || levels.front().image.meta.width != image.meta.width ||
+        levels.front().image.meta.height != image.meta.height) {
+        levels.clear();
+        levels.push_back(PyramidLevel{image, 1});
+        source = image.buffer;
+    }
+
+    auto fits = [&](const PyramidLevel &level) {
+        return level.image.meta.width <= maxWidth && level.image.meta.height <= maxHeight;
+    };
+
+    for (const PyramidLevel &level : levels) {
+        if (fits(level)) {
+            return level;
+        }
+    }
+
+    // Halve the smallest level until it fits, or cannot get any smaller
+    while (!fits(levels.back()) && (levels.back().image.meta.width > 1 || levels.back().image.meta.height > 1)) {
+        const PyramidLevel &last = levels.back();
+        ImageBuffer half = downsampleImage(viewOf(last.image));
+
+        PyramidLevel next;
+        next.image.header = last.image.header;
+        next.image.colorTable = last.image.colorTable;
+        next.image.meta = ImageMetadata(half.width, half.height, 8);
+        next.image.buffer = std::move(half.pixels);
+        next.factor = last.factor * 2;
+        levels.push_back(std::move(next));
+    }
+
+    return levels.back();
+}
+
+void ImagePyramid::clear() {
+    levels.clear();
+    source.reset();
+}
@@ -0,0 +1,44 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <vector>
+
+#include "ImageIO.h"
+
+/**
+ * @brief Halves an 8-bit image: each output pixel is the rounded mean of a 2x2 block.
+ *
+ * An odd last row or column is averaged with itself. Images of width or height 1 keep that size.
+ */
+ImageBuffer downsampleImage(const ImageView& input);
+
+// Kernel size that covers about the same area of the scene on an image `factor` times smaller (odd, >= 1).
+// A factor of 1 returns the size unchanged.
+int scaleKernelSize(int kernelSize, int factor);
+
+// One level of an ImagePyramid
+struct PyramidLevel {
+    ImageReadResult image;  // Header, color table and metadata follow the source; only the size differs
+    int factor = 1;         // How many times smaller than the source, a power of two
+};
+
+/**
+ * @brief Successively halved copies of an image, for previewing operations at screen size.
+ *
+ * Levels are built on first use and kept until the source pixels change. Level 0 is the
+ * source itself, shared rather than copied.
+ */
+class ImagePyramid {
+public:
+    // The largest level no bigger than maxWidth x maxHeight (the smallest level if none is).
+    // The reference is valid until the next call.
+    const PyramidLevel &levelFor(const ImageReadResult &image, int maxWidth, int maxHeight);
+
+    void clear();
+
+private:
+    PixelBuffer source;                 // Pixels level 0 was taken from
+    std::vector<PyramidLevel> levels;
+};
+
+#endif // IMAGE_PYRAMID_H
@@ -0,0 +1,372 @@
+#include "ImageStream.h"
+#include "IntensityTransformations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Row reader -----------------------------------------------------------------------------
+
+static size_t paddedRowSize(const ImageMetadata &meta) {
+    return ((static_cast<size_t>(meta.width) * meta.bitDepth + 31) / 32) * 4;
+}
+
+bool BmpRowReader::open(const std::string &filePath) {
+    log(INFO, "Opening file for streaming: " + filePath);
+
+    file.open(filePath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        log(ERROR, "Failed to open file: " + filePath);
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    // Read the header
+    headerBytes.resize(HEADER_SIZE);
+    file.read(reinterpret_cast<char *>(headerBytes.data()), HEADER_SIZE);
+    if (!file || headerBytes[0] != 'B' || headerBytes[1] != 'M') {
+        log(ERROR, "File is not a valid BMP file.");
+        file.close();
+        return false;
+    }
+
+    int32_t width, height, offset;
+    uint16_t bitDepth;
+    std::memcpy(&width, &headerBytes[18], sizeof(width));
+    std::memcpy(&height, &headerBytes[22], sizeof(height));
+    std::memcpy(&bitDepth, &headerBytes[28], sizeof(bitDepth));
+    std::memcpy(&offset, &headerBytes[10], sizeof(offset));
+    metadata = ImageMetadata(width, height, bitDepth);
+
+    if (!metadata.isValid()) {
+        log(ERROR, "Invalid metadata extracted from image header.");
+        file.close();
+        return false;
+    }
+    if (metadata.bitDepth != 8 && metadata.bitDepth != 24) {
+        log(ERROR, "Unsupported bit depth: " + std::to_string(metadata.bitDepth));
+        file.close();
+        return false;
+    }
+
+    // Read the color table if applicable
+    colorTableBytes.clear();
+    if (metadata.bitDepth <= 8) {
+        colorTableBytes.resize(COLOR_TABLE_SIZE);
+        file.read(reinterpret_cast<char *>(colorTableBytes.data()), COLOR_TABLE_SIZE);
+        if (!file) {
+            log(ERROR, "Failed to read color table.");
+            file.close();
+            return false;
+        }
+    }
+
+    pixelOffset = std::max<std::streamoff>(static_cast<uint32_t>(offset), HEADER_SIZE + colorTableBytes.size());
+    uint64_t pixelBytes = static_cast<uint64_t>(paddedRowSize(metadata)) * metadata.height;
+    if (static_cast<uint64_t>(pixelOffset) > fileSize || pixelBytes > fileSize - pixelOffset) {
+        log(ERROR, "Pixel data is truncated.");
+        file.close();
+        return false;
+    }
+
+    padding.resize(paddedRowSize(metadata) - rowBytes());
+    return rewind();
+}
+
+bool BmpRowReader::readRow(uint8_t *row) {
+    if (!file.is_open() || rowsRead >= metadata.height) {
+        return false;
+    }
+
+    file.read(reinterpret_cast<char *>(row), static_cast<std::streamsize>(rowBytes()));
+    file.read(reinterpret_cast<char *>(padding.data()), static_cast<std::streamsize>(padding.size()));
+    if (!file) {
+        log(ERROR, "Failed to read pixel data.");
+        return false;
+    }
+
+    ++rowsRead;
+    return true;
+}
+
+bool BmpRowReader::rewind() {
+    file.clear();
+    file.seekg(pixelOffset, std::ios::beg);
+    rowsRead = 0;
+    return static_cast<bool>(file);
+}
+
+// Row writer -----------------------------------------------------------------------------
+
+bool BmpRowWriter::open(const std::string &filePath, const std::vector<uint8_t> &header,
+                        const std::vector<uint8_t> &colorTable, const ImageMetadata &meta) {
+    log(INFO, "Writing image to: " + filePath);
+
+    if (!meta.isValid() || header.size() < HEADER_SIZE) {
+        log(ERROR, "Invalid metadata. Cannot write image.");
+        return false;
+    }
+
+    file.open(filePath, std::ios::binary);
+    if (!file) {
+        log(ERROR, "Failed to open file for writing: " + filePath);
+        return false;
+    }
+
+    metadata = meta;
+    rowsWritten = 0;
+    padding.assign(paddedRowSize(meta) - rowBytes(), 0);
+
+    // Keep the source header, but make the sizes and pixel offset match what we write
+    uint64_t pixelOffset = HEADER_SIZE + colorTable.size();
+    uint64_t imageSize = static_cast<uint64_t>(paddedRowSize(meta)) * meta.height;
+    std::vector<uint8_t> updatedHeader(header.begin(), header.begin() + HEADER_SIZE);
+    auto writeUint32 = [&](size_t offset, uint64_t value) {
+        uint32_t narrowed = static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+        std::memcpy(updatedHeader.data() + offset, &narrowed, sizeof(narrowed));
+    };
+    writeUint32(2, pixelOffset + imageSize);
+    writeUint32(10, pixelOffset);
+    writeUint32(34, imageSize);
+
+    file.write(reinterpret_cast<const char *>(updatedHeader.data()), HEADER_SIZE);
+    file.write(reinterpret_cast<const char *>(colorTable.data()), static_cast<std::streamsize>(colorTable.size()));
+    if (!file) {
+        log(ERROR, "Failed to write image header.");
+        return false;
+    }
+    return true;
+}
+
+bool BmpRowWriter::writeRow(const uint8_t *row) {
+    if (!file.is_open() || rowsWritten >= metadata.height) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(row), static_cast<std::streamsize>(rowBytes()));
+    file.write(reinterpret_cast<const char *>(padding.data()), static_cast<std::streamsize>(padding.size()));
+    if (!file) {
+        log(ERROR, "Failed to write pixel data.");
+        return false;
+    }
+
+    ++rowsWritten;
+    return true;
+}
+
+bool BmpRowWriter::close() {
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.close();
+    if (!file || rowsWritten != metadata.height) {
+        log(ERROR, "Failed to write the complete image.");
+        return false;
+    }
+
+    log(INFO, "Image successfully written.");
+    return true;
+}
+
+// Ring buffer of rows --------------------------------------------------------------------
+
+// Index of the pixel that stands in for `index` outside [0, length), or -1 for a zero pixel
+static int paddedIndex(int index, int length, PaddingChoice paddingChoice) {
+    if (index >= 0 && index < length) {
+        return index;
+    }
+
+    switch (paddingChoice) {
+        case PaddingChoice::REPLICATE:
+            return std::clamp(index, 0, length - 1);
+        case PaddingChoice::REFLECT:
+            index = (index < 0) ? -index - 1 : 2 * length - index - 1;
+            return std::clamp(index, 0, length - 1);
+        default:
+            return -1;
+    }
+}
+
+/* Calls visit(i, rows) for every row i of the image, with rows pointing at the 2 * radius + 1
+   padded rows around it. File row s lives in ring slot s % (2 * radius + 1): the rows a window
+   needs, padding included, always lie within [i - radius, i + radius], so the slot of a row is
+   only reused once no window needs it any more. */
+static bool scanRows(BmpRowReader &reader, int radius, PaddingChoice paddingChoice,
+                     const std::function<void(int, const uint8_t *const *)> &visit) {
+    const ImageMetadata &meta = reader.meta();
+    int width = meta.width;
+    int height = meta.height;
+    int windowRows = 2 * radius + 1;
+    size_t paddedWidth = static_cast<size_t>(width) + 2 * radius;
+
+    std::vector<uint8_t> ring(paddedWidth * windowRows, 0);
+    std::vector<uint8_t> zeroRow(paddedWidth, 0);
+    std::vector<const uint8_t *> rows(windowRows);
+
+    auto slot = [&](int fileRow) { return ring.data() + (fileRow % windowRows) * paddedWidth; };
+
+    int nextRow = 0;
+    for (int i = 0; i < height; ++i) {
+        // Bring in every row up to the bottom of this window
+        for (; nextRow <= std::min(i + radius, height - 1); ++nextRow) {
+            uint8_t *row = slot(nextRow);
+            if (!reader.readRow(row + radius)) {
+                return false;
+            }
+            for (int c = 1; c <= radius; ++c) {
+                int left = paddedIndex(-c, width, paddingChoice);
+                int right = paddedIndex(width - 1 + c, width, paddingChoice);
+                row[radius - c] = (left < 0) ? 0 : row[radius + left];
+                row[radius + width - 1 + c] = (right < 0) ? 0 : row[radius + right];
+            }
+        }
+
+        for (int k = 0; k < windowRows; ++k) {
+            int source = paddedIndex(i - radius + k, height, paddingChoice);
+            rows[k] = (source < 0) ? zeroRow.data() : slot(source);
+        }
+        visit(i, rows.data());
+    }
+
+    return true;
+}
+
+// Streamed operations --------------------------------------------------------------------
+
+bool streamNeighbourhoodOp(const std::string &inputPath, const std::string &outputPath, int radius,
+                           PaddingChoice paddingChoice, const StreamRowOp &op) {
+    if (radius < 0) {
+        throw std::invalid_argument("Neighbourhood radius must be non-negative!");
+    }
+
+    BmpRowReader reader;
+    if (!reader.open(inputPath)) {
+        return false;
+    }
+    if (reader.meta().bitDepth != 8) {
+        log(ERROR, "Streaming supports 8-bit images only.");
+        return false;
+    }
+
+    BmpRowWriter writer;
+    if (!writer.open(outputPath, reader.header(), reader.colorTable(), reader.meta())) {
+        return false;
+    }
+
+    std::vector<uint8_t> output(writer.rowBytes());
+    bool written = true;
+    bool scanned = scanRows(reader, radius, paddingChoice, [&](int, const uint8_t *const *rows) {
+        op(rows, output.data(), reader.meta().width);
+        written = writer.writeRow(output.data()) && written;
+    });
+
+    return writer.close() && scanned && written;
+}
+
+bool streamNegative(const std::string &inputPath, const std::string &outputPath) {
+    IntensityLut lut = makeNegativeLut(8);
+    return streamNeighbourhoodOp(inputPath, outputPath, 0, PaddingChoice::NONE,
+                                 [&lut](const uint8_t *const *rows, uint8_t *output, int width) {
+        applyLut(rows[0], output, width, lut);
+    });
+}
+
+bool streamThreshold(const std::string &inputPath, const std::string &outputPath, int threshold) {
+    IntensityLut lut = makeThresholdLut(threshold);
+    return streamNeighbourhoodOp(inputPath, outputPath, 0, PaddingChoice::NONE,
+                                 [&lut](const uint8_t *const *rows, uint8_t *output, int width) {
+        applyLut(rows[0], output, width, lut);
+    });
+}
+
+bool streamGradientEdgeDetection(const std::string &inputPath, const std::string &outputPath,
+                                 KernelChoice kernelChoice, bool applyThreshold, double thresholdValue,
+                                 PaddingChoice paddingChoice) {
+    // Same kernels as applyGradientEdgeDetection; Roberts uses the top left 2x2 of its 3x3 slot,
+    // i.e. the pixel and its neighbours to the right and below
+    static const int sobelX[3][3] = {{-1, 0, +1}, {-2, 0, +2}, {-1, 0, +1}};
+    static const int sobelY[3][3] = {{-1, -2, -1}, {0, 0, 0}, {+1, +2, +1}};
+    static const int prewittX[3][3] = {{-1, 0, +1}, {-1, 0, +1}, {-1, 0, +1}};
+    static const int prewittY[3][3] = {{-1, -1, -1}, {0, 0, 0}, {+1, +1, +1}};
+    static const int robertsX[3][3] = {{0, 0, 0}, {0, +1, 0}, {0, 0, -1}};
+    static const int robertsY[3][3] = {{0, 0, 0}, {0, 0, +1}, {0, -1, 0}};
+
+    const int (*gx)[3] = nullptr;
+    const int (*gy)[3] = nullptr;
+    switch (kernelChoice) {
+        case KernelChoice::SOBEL:   gx = sobelX;   gy = sobelY;   break;
+        case KernelChoice::PREWITT: gx = prewittX; gy = prewittY; break;
+        case KernelChoice::ROBERTS: gx = robertsX; gy = robertsY; break;
+        default:
+            throw std::invalid_argument("Unknown kernel choice!");
+    }
+
+    auto magnitudes = [&](const uint8_t *const *rows, float *output, int width) {
+        for (int j = 0; j < width; ++j) {
+            float sumX = 0.f;
+            float sumY = 0.f;
+            for (int ki = 0; ki < 3; ++ki) {
+                for (int kj = 0; kj < 3; ++kj) {
+                    uint8_t pixelVal = rows[ki][j + kj];
+                    sumX += pixelVal * gx[ki][kj];
+                    sumY += pixelVal * gy[ki][kj];
+                }
+            }
+            output[j] = std::sqrt(sumX * sumX + sumY * sumY);
+        }
+    };
+
+    if (applyThreshold) {
+        std::vector<float> row;
+        return streamNeighbourhoodOp(inputPath, outputPath, 1, paddingChoice,
+                                     [&](const uint8_t *const *rows, uint8_t *output, int width) {
+            row.resize(width);
+            magnitudes(rows, row.data(), width);
+            for (int j = 0; j < width; ++j) {
+                output[j] = (row[j] >= thresholdValue) ? 255 : 0;
+            }
+        });
+    }
+
+    // First pass: the range of the magnitudes, needed to scale them to 0..255
+    BmpRowReader reader;
+    if (!reader.open(inputPath)) {
+        return false;
+    }
+    if (reader.meta().bitDepth != 8) {
+        log(ERROR, "Streaming supports 8-bit images only.");
+        return false;
+    }
+
+    std::vector<float> row(reader.meta().width);
+    float minVal = 0.f;
+    float maxVal = 0.f;
+    bool scanned = scanRows(reader, 1, paddingChoice, [&](int i, const uint8_t *const *rows) {
+        magnitudes(rows, row.data(), static_cast<int>(row.size()));
+        auto [rowMin, rowMax] = std::minmax_element(row.begin(), row.end());
+        minVal = (i == 0) ? *rowMin : std::min(minVal, *rowMin);
+        maxVal = (i == 0) ? *rowMax : std::max(maxVal, *rowMax);
+    });
+    if (!scanned) {
+        return false;
+    }
+
+    // Second pass: scale exactly as applyGradientEdgeDetection does
+    float range = maxVal - minVal;
+    return streamNeighbourhoodOp(inputPath, outputPath, 1, paddingChoice,
+                                 [&](const uint8_t *const *rows, uint8_t *output, int width) {
+        if (range < 1e-5) {
+            std::fill(output, output + width, 0);
+            return;
+        }
+        magnitudes(rows, row.data(), width);
+        for (int j = 0; j < width; ++j) {
+            float normVal = (row[j] - minVal) / range;
+            float scaledVal = std::clamp(normVal * 255.0f, 0.0f, 255.0f);
+            output[j] = static_cast<uint8_t>(scaledVal);
+        }
+    });
+}
@@ -0,0 +1,107 @@
+#ifndef IMAGE_STREAM_H
+#define IMAGE_STREAM_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ImageIO.h"    // To use ImageMetadata
+#include "ImageUtils.h" // To use KernelChoice / PaddingChoice
+
+/**
+ * @brief Reads the pixel rows of a BMP file one at a time, in file order.
+ *
+ * Validates the file the same way readImage does. Row padding is skipped, so
+ * each row comes out as width * bytes-per-pixel packed bytes.
+ */
+class BmpRowReader {
+public:
+    bool open(const std::string &filePath);
+    bool isOpen() const { return file.is_open(); }
+
+    const ImageMetadata &meta() const { return metadata; }
+    const std::vector<uint8_t> &header() const { return headerBytes; }
+    const std::vector<uint8_t> &colorTable() const { return colorTableBytes; }
+
+    // Reads the next row into `row` (rowBytes() bytes); false at the end or on error
+    bool readRow(uint8_t *row);
+    // Goes back to the first row
+    bool rewind();
+
+    size_t rowBytes() const { return static_cast<size_t>(metadata.width) * (metadata.bitDepth / 8); }
+
+private:
+    std::ifstream file;
+    ImageMetadata metadata;
+    std::vector<uint8_t> headerBytes;
+    std::vector<uint8_t> colorTableBytes;
+    std::vector<uint8_t> padding;   // Scratch for the bytes that pad each row to 4
+    std::streamoff pixelOffset = 0;
+    int rowsRead = 0;
+};
+
+/**
+ * @brief Writes a BMP file one pixel row at a time, padding each row to 4 bytes.
+ *
+ * The header is copied from the source image with its size fields updated, so the
+ * output is laid out exactly like the files writeImage produces.
+ */
+class BmpRowWriter {
+public:
+    bool open(const std::string &filePath, const std::vector<uint8_t> &header,
+              const std::vector<uint8_t> &colorTable, const ImageMetadata &meta);
+
+    // Writes rowBytes() bytes; false on error
+    bool writeRow(const uint8_t *row);
+    // Flushes and closes the file; false if anything failed or rows are missing
+    bool close();
+
+    size_t rowBytes() const { return static_cast<size_t>(metadata.width) * (metadata.bitDepth / 8); }
+
+private:
+    std::ofstream file;
+    ImageMetadata metadata;
+    std::vector<uint8_t> padding;
+    int rowsWritten = 0;
+};
+
+/**
+ * @brief Operation applied to one output row of a streamed neighbourhood job.
+ *
+ * `rows` holds 2 * radius + 1 pointers, to the input rows from radius above to radius
+ * below the output row. Each row carries `radius` padding pixels on both sides, so
+ * column j of a row is rows[k][radius + j]. The op writes `width` pixels to `output`.
+ */
+using StreamRowOp = std::function<void(const uint8_t *const *rows, uint8_t *output, int width)>;
+
+/**
+ * @brief Streams an 8-bit BMP through a neighbourhood op into a new BMP.
+ *
+ * Only a ring of 2 * radius + 1 rows is kept in memory, so peak memory is
+ * O(width * kernel height) whatever the image height. Pixels outside the image are
+ * filled according to paddingChoice, as by the ImageUtils padding functions
+ * (NONE behaves like ZERO).
+ *
+ * @return false if a file could not be read or written (the error is logged).
+ */
+bool streamNeighbourhoodOp(const std::string &inputPath, const std::string &outputPath, int radius,
+                           PaddingChoice paddingChoice, const StreamRowOp &op);
+
+// Streamed equivalents of the in-memory operations, same results as applyNegative,
+// applyGrayscaleToBinary and applyGradientEdgeDetection on 8-bit images
+bool streamNegative(const std::string &inputPath, const std::string &outputPath);
+bool streamThreshold(const std::string &inputPath, const std::string &outputPath, int threshold);
+
+/**
+ * @brief Gradient edge detection streamed row by row.
+ *
+ * With applyThreshold the output is the binary edge map. Without it the magnitudes are
+ * scaled by their global range, which takes a first pass over the file to find it.
+ */
+bool streamGradientEdgeDetection(const std::string &inputPath, const std::string &outputPath,
+                                 KernelChoice kernelChoice, bool applyThreshold, double thresholdValue,
+                                 PaddingChoice paddingChoice);
+
+#endif // IMAGE_STREAM_H
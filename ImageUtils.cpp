@@ -2,11 +2,12 @@
 #include <algorithm> // for std::clamp
 
 std::vector<uint8_t> replicatePadImage(
-    const std::vector<uint8_t>& inputBuffer,
-    int width,
-    int height,
+    const ImageView& input,
     int padSize
 ) {
+    int width = input.width;
+    int height = input.height;
+
     // 1. Calculate new dimensions
     int newWidth  = width  + 2 * padSize;
     int newHeight = height + 2 * padSize;
@@ -19,7 +20,7 @@ std::vector<uint8_t> replicatePadImage(
         // clamp row/col to [0, height-1] and [0, width-1]
         r = std::clamp(r, 0, height - 1);
         c = std::clamp(c, 0, width - 1);
-        return inputBuffer[r * width + c];
+        return input.row(r)[c];
     };
 
     // 4. Fill the output buffer
@@ -43,11 +44,12 @@ std::vector<uint8_t> replicatePadImage(
 }
 
 std::vector<uint8_t> zeroPadImage(
-    const std::vector<uint8_t>& inputBuffer,
-    int width,
-    int height,
+    const ImageView& input,
     int padSize
 ) {
+    int width = input.width;
+    int height = input.height;
+
     // 1. Calculate new dimensions
     int newWidth  = width  + 2 * padSize;
     int newHeight = height + 2 * padSize;
@@ -61,7 +63,7 @@ std::vector<uint8_t> zeroPadImage(
             // Map the original pixel to the new buffer
             int newR = r + padSize;
             int newC = c + padSize;
-            outputBuffer[newR * newWidth + newC] = inputBuffer[r * width + c];
+            outputBuffer[newR * newWidth + newC] = input.row(r)[c];
         }
     }
 
@@ -70,11 +72,12 @@ std::vector<uint8_t> zeroPadImage(
 }
 
 std::vector<uint8_t> reflectPadImage(
-    const std::vector<uint8_t>& inputBuffer,
-    int width,
-    int height,
+    const ImageView& input,
     int padSize
 ) {
+    int width = input.width;
+    int height = input.height;
+
     // 1. Calculate new dimensions
     int newWidth  = width  + 2 * padSize;
     int newHeight = height + 2 * padSize;
@@ -94,7 +97,7 @@ std::vector<uint8_t> reflectPadImage(
         if (c < 0)          c = -c - 1;       // reflect left
         if (c >= width)     c = 2*width - c - 1;  // reflect right
 
-        return inputBuffer[r * width + c];
+        return input.row(r)[c];
     };
 
     // 4. Fill output using reflection
@@ -110,3 +113,16 @@ std::vector<uint8_t> reflectPadImage(
 
     return outputBuffer;
 }
+
+// Packed buffers are views with stride == width
+std::vector<uint8_t> replicatePadImage(const std::vector<uint8_t>& inputBuffer, int width, int height, int padSize) {
+    return replicatePadImage(ImageView{inputBuffer.data(), width, height, width}, padSize);
+}
+
+std::vector<uint8_t> zeroPadImage(const std::vector<uint8_t>& inputBuffer, int width, int height, int padSize) {
+    return zeroPadImage(ImageView{inputBuffer.data(), width, height, width}, padSize);
+}
+
+std::vector<uint8_t> reflectPadImage(const std::vector<uint8_t>& inputBuffer, int width, int height, int padSize) {
+    return reflectPadImage(ImageView{inputBuffer.data(), width, height, width}, padSize);
+}
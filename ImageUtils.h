@@ -4,6 +4,8 @@
 #include <vector>
 #include <cstdint>
 
+#include "ImageIO.h"    // ImageView
+
 // 1. Kernel choice enum
 enum class KernelChoice {
     SOBEL = 1,
@@ -19,6 +21,12 @@ enum class PaddingChoice {
     REFLECT
 };
 
+// 3. Gaussian implementation choice
+enum class GaussianMode {
+    SEPARABLE = 0,   // Truncated kernel of the requested size, O(kernel size) per pixel
+    RECURSIVE        // Young-van Vliet IIR approximation, O(1) per pixel for any sigma
+};
+
 /**
  * @brief Creates a new image buffer with replicate padding.
  * 
@@ -69,5 +77,17 @@ std::vector<uint8_t> reflectPadImage(
     int padSize
 );
 
+/**
+ * @brief The same three paddings reading a strided view, so a caller holding part of a
+ *        larger image (or a mapped file) does not have to copy it into a packed buffer first.
+ *
+ * @param input    The original image rows.
+ * @param padSize  The number of pixels to pad on each side.
+ * @return A packed buffer of (height + 2*padSize) x (width + 2*padSize).
+ */
+std::vector<uint8_t> replicatePadImage(const ImageView& input, int padSize);
+std::vector<uint8_t> zeroPadImage(const ImageView& input, int padSize);
+std::vector<uint8_t> reflectPadImage(const ImageView& input, int padSize);
+
 
 #endif
@@ -0,0 +1,202 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <mutex>
+
+namespace instrumentation_detail {
+std::atomic<bool> enabled{false};
+}
+
+static std::mutex statsMutex;
+static std::map<std::string, OperationStats> statsByName;
+static uint64_t nextSequence = 0;
+
+// Innermost running timer of this thread
+static thread_local ScopedTimer *currentTimer = nullptr;
+
+// Open InstrumentationSuspension scopes of this thread
+static thread_local int suspensionDepth = 0;
+
+static int64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int bucketFor(double seconds) {
+    double microseconds = seconds * 1e6;
+    int bucket = 0;
+    while (bucket < TIMING_BUCKETS - 1 && microseconds >= static_cast<double>(uint64_t(2) << bucket)) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+double OperationStats::percentileSeconds(double p) const {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * calls));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < TIMING_BUCKETS; ++bucket) {
+        seen += histogram[bucket];
+        if (seen >= std::max<uint64_t>(rank, 1)) {
+            return std::min(static_cast<double>(uint64_t(2) << bucket) * 1e-6, maxSeconds);
+        }
+    }
+    return maxSeconds;
+}
+
+void setInstrumentationEnabled(bool enabled) {
+    instrumentation_detail::enabled = enabled;
+}
+
+InstrumentationSuspension::InstrumentationSuspension() {
+    ++suspensionDepth;
+}
+
+InstrumentationSuspension::~InstrumentationSuspension() {
+    --suspensionDepth;
+}
+
+// ScopedTimer ------------------------------------------------------------------------------
+
+ScopedTimer::ScopedTimer(const char *operation, uint64_t pixels)
+    : operation(operation), active(instrumentationEnabled() && suspensionDepth == 0), pixels(pixels),
+      span(operation, "operation", pixels > 0 ? TraceArg{"pixels", static_cast<long long>(pixels)} : TraceArg{}) {
+    if (!active) {
+        return;
+    }
+
+    uncaughtOnEntry = std::uncaught_exceptions();
+    outer = currentTimer;
+    currentTimer = this;
+    startNanoseconds = nowNanoseconds();
+}
+
+ScopedTimer::~ScopedTimer() {
+    if (!active) {
+        return;
+    }
+
+    double seconds = (nowNanoseconds() - startNanoseconds) * 1e-9;
+    bool failed = std::uncaught_exceptions() > uncaughtOnEntry;
+    currentTimer = outer;
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    OperationStats &stats = statsByName[operation];
+    if (stats.calls == 0) {
+        stats.name = operation;
+        stats.minSeconds = seconds;
+    }
+    ++stats.calls;
+    stats.failures += failed ? 1 : 0;
+    stats.totalSeconds += seconds;
+    stats.minSeconds = std::min(stats.minSeconds, seconds);
+    stats.maxSeconds = std::max(stats.maxSeconds, seconds);
+    stats.lastSeconds = seconds;
+    stats.lastSequence = ++nextSequence;
+    stats.pixels += pixels.load(std::memory_order_relaxed);
+    stats.bytesAllocated += bytes.load(std::memory_order_relaxed);
+    ++stats.histogram[bucketFor(seconds)];
+}
+
+void countPixels(uint64_t count) {
+    if (currentTimer) {
+        currentTimer->addPixels(count);
+    }
+}
+
+void countAllocation(uint64_t bytes) {
+    if (currentTimer) {
+        currentTimer->addBytes(bytes);
+    }
+}
+
+ScopedTimer *currentScopedTimer() {
+    return currentTimer;
+}
+
+ScopedTimerAdoption::ScopedTimerAdoption(ScopedTimer *timer) : saved(currentTimer) {
+    currentTimer = timer;
+}
+
+ScopedTimerAdoption::~ScopedTimerAdoption() {
+    currentTimer = saved;
+}
+
+// Reports ----------------------------------------------------------------------------------
+
+std::vector<OperationStats> instrumentationStats() {
+    std::vector<OperationStats> stats;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (const auto &entry : statsByName) {
+            stats.push_back(entry.second);
+        }
+    }
+
+    std::sort(stats.begin(), stats.end(), [](const OperationStats &a, const OperationStats &b) {
+        return a.totalSeconds > b.totalSeconds;
+    });
+    return stats;
+}
+
+void resetInstrumentationStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    statsByName.clear();
+}
+
+// Milliseconds with three significant digits or so
+static std::string formatMilliseconds(double seconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3g ms", seconds * 1e3);
+    return text;
+}
+
+static std::string formatThroughput(const OperationStats &stats) {
+    if (stats.pixels == 0 || stats.totalSeconds <= 0.0) {
+        return "-";
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f Mpx/s", stats.pixels / stats.totalSeconds * 1e-6);
+    return text;
+}
+
+static std::string formatBytes(uint64_t bytes) {
+    char text[32];
+    if (bytes >= (uint64_t(1) << 30)) {
+        std::snprintf(text, sizeof(text), "%.1f GiB", bytes / double(uint64_t(1) << 30));
+    } else if (bytes >= (uint64_t(1) << 20)) {
+        std::snprintf(text, sizeof(text), "%.1f MiB", bytes / double(uint64_t(1) << 20));
+    } else {
+        std::snprintf(text, sizeof(text), "%.1f KiB", bytes / 1024.0);
+    }
+    return text;
+}
+
+void dumpInstrumentation(std::ostream &out) {
+    std::vector<OperationStats> stats = instrumentationStats();
+    if (stats.empty()) {
+        out << "No operations recorded" << (instrumentationEnabled() ? "" : " (instrumentation is off)") << "\n";
+        return;
+    }
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-28s %7s %6s %11s %11s %11s %11s %14s %12s\n", "Operation", "Calls", "Failed",
+                  "Mean", "p50", "p95", "Max", "Throughput", "Allocated");
+    out << line;
+    for (const OperationStats &entry : stats) {
+        std::snprintf(line, sizeof(line), "%-28s %7llu %6llu %11s %11s %11s %11s %14s %12s\n", entry.name.c_str(),
+                      static_cast<unsigned long long>(entry.calls), static_cast<unsigned long long>(entry.failures),
+                      formatMilliseconds(entry.meanSeconds()).c_str(), formatMilliseconds(entry.percentileSeconds(50)).c_str(),
+                      formatMilliseconds(entry.percentileSeconds(95)).c_str(), formatMilliseconds(entry.maxSeconds).c_str(),
+                      formatThroughput(entry).c_str(), formatBytes(entry.bytesAllocated).c_str());
+        out << line;
+    }
+}
+
+std::string formatOperationStats(const OperationStats &stats) {
+    return stats.name + ": " + formatMilliseconds(stats.lastSeconds) + " (mean " + formatMilliseconds(stats.meanSeconds()) +
+           " over " + std::to_string(stats.calls) + (stats.calls == 1 ? " call, " : " calls, ") + formatThroughput(stats) + ")";
+}
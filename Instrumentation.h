@@ -0,0 +1,124 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "TraceRecorder.h"
+
+// Buckets of the duration histogram: bucket b counts calls that took [2^b, 2^(b+1)) microseconds
+constexpr int TIMING_BUCKETS = 32;
+
+/**
+ * @brief What one operation has done since instrumentation was enabled (or last reset).
+ */
+struct OperationStats {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t failures = 0;              // Calls left by an exception, cancellations included
+    double totalSeconds = 0.0;
+    double minSeconds = 0.0;
+    double maxSeconds = 0.0;
+    double lastSeconds = 0.0;
+    uint64_t lastSequence = 0;          // Orders the last calls of different operations; higher is later
+    uint64_t pixels = 0;                // Input pixels processed
+    uint64_t bytesAllocated = 0;        // Result and intermediate buffers allocated
+    std::array<uint64_t, TIMING_BUCKETS> histogram{};   // Bucket 0 also holds calls under a microsecond
+
+    double meanSeconds() const { return calls > 0 ? totalSeconds / calls : 0.0; }
+
+    // Upper bound of the histogram bucket holding the p-th percentile (0..100) of the call durations
+    double percentileSeconds(double p) const;
+};
+
+namespace instrumentation_detail {
+extern std::atomic<bool> enabled;
+}
+
+// Off by default; while off, timers and counters cost one relaxed load each
+void setInstrumentationEnabled(bool enabled);
+inline bool instrumentationEnabled() {
+    return instrumentation_detail::enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Stops the calling thread's timers from recording while alive.
+ *
+ * For work whose timings would skew the statistics of the operations it shares names
+ * with, such as previews on a downscaled image. Spans are still traced.
+ */
+class InstrumentationSuspension {
+public:
+    InstrumentationSuspension();
+    ~InstrumentationSuspension();
+
+    InstrumentationSuspension(const InstrumentationSuspension &) = delete;
+    InstrumentationSuspension &operator=(const InstrumentationSuspension &) = delete;
+};
+
+/**
+ * @brief Times the enclosing scope and records it as one call of `operation`.
+ *
+ * `operation` must outlive the program (a string literal). The call counts as failed if
+ * the scope is left by an exception. Pixels and allocations counted on this thread while
+ * the timer is the innermost one (countPixels, countAllocation) are added to the call, and
+ * so are those counted by the parallelFor chunks it starts, whichever thread runs them.
+ * While a trace is being recorded the scope also becomes an "operation" span.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char *operation, uint64_t pixels = 0);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    void addPixels(uint64_t count) { pixels.fetch_add(count, std::memory_order_relaxed); }
+    void addBytes(uint64_t count) { bytes.fetch_add(count, std::memory_order_relaxed); }
+
+private:
+    const char *operation;
+    bool active;
+    int uncaughtOnEntry = 0;
+    int64_t startNanoseconds = 0;
+    std::atomic<uint64_t> pixels;       // Atomic, as parallelFor chunks add to them from other threads
+    std::atomic<uint64_t> bytes{0};
+    ScopedTimer *outer = nullptr;
+    TraceSpan span;
+};
+
+// Add to the innermost ScopedTimer running on this thread; ignored when there is none
+void countPixels(uint64_t count);
+void countAllocation(uint64_t bytes);
+
+// The innermost ScopedTimer of this thread, or null
+ScopedTimer *currentScopedTimer();
+
+// Makes `timer` the innermost one of this thread while alive, so work done for it elsewhere counts towards it
+class ScopedTimerAdoption {
+public:
+    explicit ScopedTimerAdoption(ScopedTimer *timer);
+    ~ScopedTimerAdoption();
+
+    ScopedTimerAdoption(const ScopedTimerAdoption &) = delete;
+    ScopedTimerAdoption &operator=(const ScopedTimerAdoption &) = delete;
+
+private:
+    ScopedTimer *saved;
+};
+
+// Every operation recorded so far, most total time first
+std::vector<OperationStats> instrumentationStats();
+void resetInstrumentationStats();
+
+// One line per operation: calls, failures, mean / p50 / p95 / max time, throughput, allocations
+void dumpInstrumentation(std::ostream &out);
+
+// Short summary for a status line, e.g. "Gaussian filter: 12.4 ms (mean 11.9 ms over 6 calls, 84.1 Mpx/s)"
+std::string formatOperationStats(const OperationStats &stats);
+
+#endif // INSTRUMENTATION_H
@@ -1,46 +1,136 @@
 #include "IntensityTransformations.h"
 #include <cmath> // For log, pow
 
-void applyNegative(uint8_t *buffer, const ImageMetadata &meta) {
+// Lookup tables ------------------------------------------------------------------------------
+
+/* Every point operation on 8-bit pixels is a function of 256 inputs, so each transform builds its
+   table once and the per-pixel work is a single table load. */
 
-    std::cout << "Aplying Negative Transformation...\n";
+// Largest value a pixel byte can take at this bit depth
+static int maxIntensity(int bitDepth) {
+    return (bitDepth >= 8) ? 255 : (1 << bitDepth) - 1;
+}
 
-    int maxVal = (1 << meta.bitDepth) - 1;
-    for (int i = 0; i < meta.width * meta.height; i++) {
-        buffer[i] = maxVal - buffer[i];
+// Clamp to [0, maxVal] before narrowing, converting out-of-range doubles to uint8_t is undefined
+static uint8_t clampIntensity(double value, int maxVal) {
+    if (!(value > 0.0)) {
+        return 0;
     }
+    if (value > maxVal) {
+        return static_cast<uint8_t>(maxVal);
+    }
+    return static_cast<uint8_t>(value);
+}
 
-    std::cout << "Completed Negative Transformation...\n";
+IntensityLut makeIdentityLut() {
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = static_cast<uint8_t>(v);
+    }
+    return lut;
 }
 
-void applyLogTransform(uint8_t *buffer, const ImageMetadata &meta, double c) {
-    int maxVal = (1 << meta.bitDepth) - 1;
+IntensityLut makeNegativeLut(int bitDepth) {
+    int maxVal = maxIntensity(bitDepth);
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = static_cast<uint8_t>(maxVal - v);
+    }
+    return lut;
+}
 
-    std::cout << "\n Applying Log Transformation...\n";
+IntensityLut makeLogLut(int bitDepth, double c) {
+    int maxVal = maxIntensity(bitDepth);
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = clampIntensity(c * log(1 + v), maxVal);
+    }
+    return lut;
+}
 
-    for (int i = 0; i < meta.width * meta.height; i++) {
-        double transformedValue = c * log(1 + buffer[i]);
-        if (transformedValue > maxVal) {
-            transformedValue = maxVal; // Clamp the value
-        }
-        buffer[i] = static_cast<uint8_t>(transformedValue);
+IntensityLut makeGammaLut(int bitDepth, double c, double gamma) {
+    int maxVal = maxIntensity(bitDepth);
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = clampIntensity(c * pow(v, gamma), maxVal);
     }
+    return lut;
+}
 
-    std::cout << "Completed Log Transformation...\n";
+IntensityLut makeThresholdLut(int threshold) {
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = (v > threshold) ? 255 : 0; // 255 for white, 0 for black
+    }
+    return lut;
 }
 
-void applyGammaTransform(uint8_t *buffer, const ImageMetadata &meta, double c, double gamma) {
-    int maxVal = (1 << meta.bitDepth) - 1;
+IntensityLut composeLuts(const IntensityLut &first, const IntensityLut &second) {
+    IntensityLut lut;
+    for (int v = 0; v < 256; ++v) {
+        lut[v] = second[first[v]];
+    }
+    return lut;
+}
 
-    std::cout << "\n Applying Gamma Transformation...\n";
+/* Eight independent loads per iteration keep several table lookups in flight. A shuffle-based gather
+   (16 pshufb over 16-entry slices, selected by the high nibble) was measured at about twice the cost
+   of this loop for a full 256-entry table, so plain loads are used. */
+void applyLut(const uint8_t *input, uint8_t *output, size_t count, const IntensityLut &lut) {
+    const uint8_t *table = lut.data();
 
-    for (int i = 0; i < meta.width * meta.height; i++) {
-        double transformedValue = c * pow(buffer[i], gamma);
-        if (transformedValue > maxVal) {
-            transformedValue = maxVal; // Clamp the value
-        }
-        buffer[i] = static_cast<uint8_t>(transformedValue);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint8_t v0 = table[input[i]];
+        uint8_t v1 = table[input[i + 1]];
+        uint8_t v2 = table[input[i + 2]];
+        uint8_t v3 = table[input[i + 3]];
+        uint8_t v4 = table[input[i + 4]];
+        uint8_t v5 = table[input[i + 5]];
+        uint8_t v6 = table[input[i + 6]];
+        uint8_t v7 = table[input[i + 7]];
+        output[i] = v0;
+        output[i + 1] = v1;
+        output[i + 2] = v2;
+        output[i + 3] = v3;
+        output[i + 4] = v4;
+        output[i + 5] = v5;
+        output[i + 6] = v6;
+        output[i + 7] = v7;
     }
+    for (; i < count; ++i) {
+        output[i] = table[input[i]];
+    }
+}
+
+// Intensity transformations ------------------------------------------------------------------
+
+void applyNegative(uint8_t *buffer, const ImageMetadata &meta) {
+
+    LOG_MESSAGE(DEBUG, "Applying Negative Transformation...");
+
+    size_t pixels = static_cast<size_t>(meta.width) * meta.height;
+    applyLut(buffer, buffer, pixels, makeNegativeLut(meta.bitDepth));
+
+    LOG_MESSAGE(DEBUG, "Completed Negative Transformation...");
+}
+
+void applyLogTransform(uint8_t *buffer, const ImageMetadata &meta, double c) {
+
+    LOG_MESSAGE(DEBUG, "Applying Log Transformation...");
+
+    size_t pixels = static_cast<size_t>(meta.width) * meta.height;
+    applyLut(buffer, buffer, pixels, makeLogLut(meta.bitDepth, c));
+
+    LOG_MESSAGE(DEBUG, "Completed Log Transformation...");
+}
+
+void applyGammaTransform(uint8_t *buffer, const ImageMetadata &meta, double c, double gamma) {
+
+    LOG_MESSAGE(DEBUG, "Applying Gamma Transformation...");
+
+    size_t pixels = static_cast<size_t>(meta.width) * meta.height;
+    applyLut(buffer, buffer, pixels, makeGammaLut(meta.bitDepth, c, gamma));
 
-    std::cout << "Completed Gamma Transformation...\n";
+    LOG_MESSAGE(DEBUG, "Completed Gamma Transformation...");
 }
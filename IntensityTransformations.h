@@ -2,8 +2,26 @@
 #define IMAGE_TRANSFORMS_H
 
 #include <stdint.h> // For uint8_t
+#include <stddef.h> // For size_t
+#include <array>
 #include "ImageIO.h"
 
+// Lookup table holding the output value for each of the 256 possible input values
+using IntensityLut = std::array<uint8_t, 256>;
+
+// Lookup table builders; every value is computed once instead of once per pixel
+IntensityLut makeIdentityLut();
+IntensityLut makeNegativeLut(int bitDepth);
+IntensityLut makeLogLut(int bitDepth, double c);
+IntensityLut makeGammaLut(int bitDepth, double c, double gamma);
+IntensityLut makeThresholdLut(int threshold);
+
+// The table for applying `first` and then `second`: result[v] = second[first[v]]
+IntensityLut composeLuts(const IntensityLut &first, const IntensityLut &second);
+
+// output[i] = lut[input[i]] for count pixels; input and output may be the same buffer
+void applyLut(const uint8_t *input, uint8_t *output, size_t count, const IntensityLut &lut);
+
 void applyNegative(uint8_t *buffer, const ImageMetadata &meta);
 void applyLogTransform(uint8_t *buffer, const ImageMetadata &meta, double c);
 void applyGammaTransform(uint8_t *buffer, const ImageMetadata &meta, double c, double gamma);
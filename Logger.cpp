@@ -0,0 +1,264 @@
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Slots of the ring, a power of two
+constexpr size_t LOG_RING_SLOTS = 1024;
+
+// Bytes of message text a slot holds; longer messages are cut
+constexpr size_t LOG_MESSAGE_BYTES = 240;
+
+// How long the writer sleeps when nobody wakes it; bounds the delay of INFO messages
+constexpr std::chrono::milliseconds LOG_WRITE_INTERVAL(20);
+
+static const char *levelPrefix(LogLevel level) {
+    switch (level) {
+        case DEBUG: return "[DEBUG]";
+        case INFO: return "[INFO]";
+        case WARNING: return "[WARNING]";
+        default: return "[ERROR]";
+    }
+}
+
+/*
+ * Bounded multi-producer queue after Dmitry Vyukov: every slot carries a sequence number
+ * that says whose turn it is, so producers claim slots with one compare-and-swap and the
+ * single consumer needs no atomic read-modify-write at all.
+ */
+class LogRing {
+public:
+    LogRing() {
+        for (size_t i = 0; i < LOG_RING_SLOTS; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Returns false, dropping the message, when the ring is full
+    bool push(LogLevel level, const std::string &message) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &slots[position & (LOG_RING_SLOTS - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        slot->length = std::min(message.size(), LOG_MESSAGE_BYTES);
+        std::memcpy(slot->text, message.data(), slot->length);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only; appends the next message as a line to `out`, false if it is not there (yet)
+    bool pop(std::string &out) {
+        Slot &slot = slots[dequeuePosition & (LOG_RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+            return false;
+        }
+
+        out += levelPrefix(slot.level);
+        out += ' ';
+        out.append(slot.text, slot.length);
+        if (slot.length == LOG_MESSAGE_BYTES) {
+            out += "...";
+        }
+        out += '\n';
+
+        slot.sequence.store(dequeuePosition + LOG_RING_SLOTS, std::memory_order_release);
+        ++dequeuePosition;
+        return true;
+    }
+
+    size_t claimed() const { return enqueuePosition.load(std::memory_order_acquire); }
+    size_t consumed() const { return dequeuePosition; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogLevel level = INFO;
+        size_t length = 0;
+        char text[LOG_MESSAGE_BYTES];
+    };
+
+    Slot slots[LOG_RING_SLOTS];
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) size_t dequeuePosition = 0;
+};
+
+// Logger -----------------------------------------------------------------------------------
+
+class AsyncLogger {
+public:
+    AsyncLogger() : writer(&AsyncLogger::writerMain, this) {}
+
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        writer.join();
+    }
+
+    void post(LogLevel level, const std::string &message) {
+        if (level < WARNING && !withinRateLimit()) {
+            ++dropped;
+            return;
+        }
+        if (!ring.push(level, message)) {
+            ++dropped;
+            return;
+        }
+
+        // Errors go out promptly; otherwise the writer's own interval is soon enough and saves a wakeup per message
+        if (level >= ERROR) {
+            wake.notify_one();
+        }
+    }
+
+    void flush() {
+        size_t target = ring.claimed();
+        std::unique_lock<std::mutex> lock(mutex);
+        flushTarget = std::max(flushTarget.load(), target);
+        wake.notify_all();
+        written.wait(lock, [&] { return writtenPosition >= target; });
+    }
+
+    void setStream(std::ostream &stream) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out = &stream;
+    }
+
+    std::atomic<int> rateLimit{1000};
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    // At most rateLimit messages per wall-clock second; the window reset may race, which only blurs the edge
+    bool withinRateLimit() {
+        int limit = rateLimit.load(std::memory_order_relaxed);
+        if (limit <= 0) {
+            return true;
+        }
+
+        int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+                             std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t current = windowSecond.load(std::memory_order_relaxed);
+        if (current != second && windowSecond.compare_exchange_strong(current, second, std::memory_order_relaxed)) {
+            windowCount.store(0, std::memory_order_relaxed);
+        }
+        return windowCount.fetch_add(1, std::memory_order_relaxed) < limit;
+    }
+
+    void writerMain() {
+        std::string batch;
+        uint64_t reportedDrops = 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait_for(lock, LOG_WRITE_INTERVAL, [&] { return stopping || flushTarget > writtenPosition; });
+            bool stop = stopping;
+
+            // Drain whatever is there, and keep going while a flush waits on slots still being filled
+            lock.unlock();
+            batch.clear();
+            for (;;) {
+                while (ring.pop(batch)) {
+                }
+                uint64_t drops = dropped.load();
+                if (drops != reportedDrops) {
+                    batch += "[WARNING] " + std::to_string(drops - reportedDrops) + " log message(s) dropped\n";
+                    reportedDrops = drops;
+                }
+                if (ring.consumed() >= std::min(flushTarget.load(), ring.claimed())) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            lock.lock();
+
+            if (!batch.empty()) {
+                *out << batch;
+                out->flush();
+            }
+            writtenPosition = ring.consumed();
+            written.notify_all();
+
+            if (stop && ring.consumed() == ring.claimed()) {
+                return;
+            }
+        }
+    }
+
+    LogRing ring;
+    std::atomic<int64_t> windowSecond{0};
+    std::atomic<int> windowCount{0};
+
+    std::mutex mutex;                           // Guards the stream and the positions below, never taken by log()
+    std::condition_variable wake;
+    std::condition_variable written;
+    std::ostream *out = &std::cerr;
+    std::atomic<size_t> flushTarget{0};
+    size_t writtenPosition = 0;
+    bool stopping = false;
+
+    std::thread writer;                         // Last, so it starts once everything above is set up
+};
+
+static AsyncLogger &logger() {
+    static AsyncLogger instance;
+    return instance;
+}
+
+static std::atomic<int> minimumLevel{INFO};
+
+void log(LogLevel level, const std::string &message) {
+    if (!logEnabled(level)) {
+        return;
+    }
+    logger().post(level, message);
+}
+
+void setLogLevel(LogLevel level) {
+    minimumLevel = level;
+}
+
+LogLevel logLevel() {
+    return static_cast<LogLevel>(minimumLevel.load());
+}
+
+bool logEnabled(LogLevel level) {
+    return level >= minimumLevel.load(std::memory_order_relaxed);
+}
+
+void setLogRateLimit(int messagesPerSecond) {
+    logger().rateLimit = messagesPerSecond;
+}
+
+void setLogStream(std::ostream &stream) {
+    logger().setStream(stream);
+}
+
+void flushLog() {
+    logger().flush();
+}
+
+uint64_t droppedLogMessages() {
+    return logger().dropped.load();
+}
@@ -0,0 +1,67 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+ * Logging ----------------------------------------------------------------------------------
+ *
+ * log() copies the message into a fixed-size lock-free ring and returns; a background
+ * thread writes the ring out to the log stream (std::cerr by default) and flushes once
+ * per batch, so a kernel or a batch job never waits on the terminal or a file. When the
+ * ring is full, or DEBUG and INFO messages exceed the rate limit, messages are dropped
+ * and the writer reports how many. Messages longer than a ring slot are truncated.
+ *
+ * Levels below IMAGE_PROCESSING_MIN_LOG_LEVEL are removed at compile time by LOG_MESSAGE,
+ * message formatting included: DEBUG is kept only in builds without NDEBUG.
+ */
+
+// Log Levels for Debugging
+enum LogLevel { DEBUG, INFO, WARNING, ERROR };
+
+#ifndef IMAGE_PROCESSING_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define IMAGE_PROCESSING_MIN_LOG_LEVEL INFO
+#else
+#define IMAGE_PROCESSING_MIN_LOG_LEVEL DEBUG
+#endif
+#endif
+
+/**
+ * Logs messages with specified log levels.
+ *
+ * @param level The log level (DEBUG, INFO, WARNING, or ERROR).
+ * @param message The message to log.
+ */
+void log(LogLevel level, const std::string &message);
+
+// Messages below this level are discarded before they reach the ring (default INFO)
+void setLogLevel(LogLevel level);
+LogLevel logLevel();
+bool logEnabled(LogLevel level);
+
+// DEBUG and INFO messages accepted per second, 0 for no limit (default 1000); warnings and errors are not limited
+void setLogRateLimit(int messagesPerSecond);
+
+// Where the background thread writes; the stream must outlive the logger or the next setLogStream()
+void setLogStream(std::ostream &stream);
+
+// Waits until every message logged before the call has been written
+void flushLog();
+
+// Messages dropped so far because the ring was full or the rate limit was hit
+uint64_t droppedLogMessages();
+
+// Logs `message` unless the level is compiled out or below the runtime level; `message` is only evaluated if it is logged
+#define LOG_MESSAGE(level, message)                                 \
+    do {                                                            \
+        if constexpr ((level) >= IMAGE_PROCESSING_MIN_LOG_LEVEL) {  \
+            if (logEnabled(level)) {                                \
+                log(level, message);                                \
+            }                                                       \
+        }                                                           \
+    } while (false)
+
+#endif // LOGGER_H
@@ -0,0 +1,342 @@
+#include "ParallelExecutor.h"
+#include "ProcessingControl.h"
+#include "TraceRecorder.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <string>
+
+// Chunks per thread: enough that stealing can even out uneven rows, and to report progress and stop often
+constexpr int CHUNKS_PER_THREAD = 8;
+
+// Even on one thread the range is cut this fine, so progress and cancellation still work
+constexpr int MIN_CHUNK_COUNT = 32;
+
+// How long a caller waiting for chunks other threads are running sleeps before looking for work again
+constexpr std::chrono::microseconds CALLER_POLL_INTERVAL(200);
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t nanosecondsSince(Clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+// One parallelFor call, shared by the caller and the workers that run its chunks
+struct ParallelExecutor::Loop {
+    const ParallelBody *body = nullptr;
+    int begin = 0;
+    int end = 0;
+    int chunkSize = 1;
+    int chunkCount = 0;
+    ProcessingState state;                      // Caller's context and progress stage
+    const char *traceName = nullptr;            // Chunks show in a trace under the caller's innermost span
+    ScopedTimer *timer = nullptr;               // Chunks count their pixels and allocations towards the caller's timer
+
+    std::atomic<int> finishedChunks{0};
+    std::atomic<long long> doneItems{0};
+    std::atomic<bool> failed{false};
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;                   // First exception a chunk threw
+
+    bool isFinished() const { return finishedChunks.load() == chunkCount; }
+};
+
+// Chunks [first, last) of a loop, not started yet
+struct ParallelExecutor::Task {
+    std::shared_ptr<Loop> loop;
+    int first = 0;
+    int last = 0;
+};
+
+struct ParallelExecutor::Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;                     // The owner works at the front, thieves take from the back
+
+    std::atomic<uint64_t> chunks{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> busyNanoseconds{0};
+    std::atomic<uint64_t> idleNanoseconds{0};
+};
+
+// The executor and worker index of the current thread, so nested loops use the worker's own deque
+static thread_local const ParallelExecutor *currentExecutor = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+ParallelExecutor::ParallelExecutor(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    for (int t = 1; t < threadCount; ++t) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (int t = 0; t < static_cast<int>(workers.size()); ++t) {
+        threads.emplace_back(&ParallelExecutor::workerMain, this, t);
+    }
+}
+
+ParallelExecutor::~ParallelExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void ParallelExecutor::push(int workerIndex, const Task &task) {
+    {
+        std::lock_guard<std::mutex> lock(workers[workerIndex]->mutex);
+        workers[workerIndex]->tasks.push_front(task);
+    }
+    ++queuedTasks;
+
+    // Taking the lock orders this with a worker that is about to sleep, so the wakeup is not lost
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool ParallelExecutor::popOwn(Worker &worker, Task &task) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    --queuedTasks;
+    return true;
+}
+
+bool ParallelExecutor::steal(int thiefIndex, const Loop *only, Task &task) {
+    int count = static_cast<int>(workers.size());
+
+    // A worker waiting on a nested loop starts with its own deque, where its split-off halves went
+    for (int offset = 0; offset < count; ++offset) {
+        int victimIndex = (std::max(thiefIndex, 0) + offset) % count;
+
+        Worker &victim = *workers[victimIndex];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        // The back holds the oldest and largest ranges; a waiting caller only takes chunks of its own loop
+        for (auto it = victim.tasks.rbegin(); it != victim.tasks.rend(); ++it) {
+            if (only == nullptr || it->loop.get() == only) {
+                task = std::move(*it);
+                victim.tasks.erase(std::next(it).base());
+                --queuedTasks;
+
+                if (thiefIndex >= 0 && victimIndex != thiefIndex) {
+                    ++workers[thiefIndex]->steals;
+                }
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ParallelExecutor::runChunk(Loop &loop, int chunk) {
+    if (!loop.failed.load()) {
+        ProcessingScope scope(loop.state);
+        int chunkBegin = loop.begin + chunk * loop.chunkSize;
+        int chunkEnd = std::min(chunkBegin + loop.chunkSize, loop.end);
+        TraceSpan span(loop.traceName, "chunk", {"begin", chunkBegin}, {"end", chunkEnd});
+        ScopedTimerAdoption adoption(loop.timer);
+
+        try {
+            throwIfCancelled();
+            (*loop.body)(chunkBegin, chunkEnd);
+            reportProgress(loop.doneItems += chunkEnd - chunkBegin, static_cast<long long>(loop.end) - loop.begin);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (!loop.error) {
+                loop.error = std::current_exception();
+            }
+            loop.failed = true;
+        }
+    }
+
+    if (++loop.finishedChunks == loop.chunkCount) {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        loop.finished.notify_all();
+    }
+}
+
+void ParallelExecutor::runTask(Task task, Worker *owner) {
+    // Halve the range until one chunk is left, leaving the upper halves where other threads can steal them
+    while (task.last - task.first > 1) {
+        int middle = task.first + (task.last - task.first) / 2;
+        Task upper{task.loop, middle, task.last};
+        task.last = middle;
+
+        if (owner) {
+            push(currentWorkerIndex, upper);
+        } else {
+            push(static_cast<int>(nextWorker++ % workers.size()), upper);
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    runChunk(*task.loop, task.first);
+
+    if (owner) {
+        ++owner->chunks;
+        owner->busyNanoseconds += nanosecondsSince(start);
+    }
+}
+
+void ParallelExecutor::workerMain(int index) {
+    currentExecutor = this;
+    currentWorkerIndex = index;
+    Worker &self = *workers[index];
+    setTraceThreadName("Worker " + std::to_string(index + 1));
+
+    for (;;) {
+        Task task;
+        if (popOwn(self, task) || steal(index, nullptr, task)) {
+            runTask(std::move(task), &self);
+            continue;
+        }
+
+        Clock::time_point start = Clock::now();
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queuedTasks.load() > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+        self.idleNanoseconds += nanosecondsSince(start);
+    }
+}
+
+void ParallelExecutor::parallelFor(int begin, int end, int minChunk, const ParallelBody &body) {
+    if (end <= begin) {
+        return;
+    }
+
+    auto loop = std::make_shared<Loop>();
+    loop->body = &body;
+    loop->begin = begin;
+    loop->end = end;
+    loop->state = currentProcessingState();
+    loop->traceName = currentTraceSpanName("parallelFor");
+    loop->timer = currentScopedTimer();
+
+    int items = end - begin;
+    int targetChunks = std::max(MIN_CHUNK_COUNT, threadCount() * CHUNKS_PER_THREAD);
+    loop->chunkSize = std::max({1, minChunk, (items + targetChunks - 1) / targetChunks});
+    loop->chunkCount = (items + loop->chunkSize - 1) / loop->chunkSize;
+
+    if (loop->chunkCount == 1 || workers.empty()) {
+        for (int chunk = 0; chunk < loop->chunkCount; ++chunk) {
+            runChunk(*loop, chunk);
+        }
+    } else {
+        Worker *owner = (currentExecutor == this) ? workers[currentWorkerIndex].get() : nullptr;
+
+        // One contiguous block per thread to start with; stealing rebalances from there
+        int blocks = std::min(threadCount(), loop->chunkCount);
+        auto blockStart = [&](int block) { return static_cast<int>(static_cast<long long>(loop->chunkCount) * block / blocks); };
+
+        unsigned firstWorker = owner ? static_cast<unsigned>(currentWorkerIndex + 1) : nextWorker.fetch_add(1);
+        for (int block = 1; block < blocks; ++block) {
+            push(static_cast<int>((firstWorker + block - 1) % workers.size()), Task{loop, blockStart(block), blockStart(block + 1)});
+        }
+
+        // The caller works too, so a loop started from inside a chunk cannot wait on itself
+        runTask(Task{loop, 0, blockStart(1)}, owner);
+
+        // Open while the caller has nothing left to run, so a straggling chunk shows as a wait in the trace
+        std::optional<TraceSpan> waiting;
+
+        while (!loop->isFinished()) {
+            Task task;
+            if (steal(owner ? currentWorkerIndex : -1, loop.get(), task)) {
+                waiting.reset();
+                runTask(std::move(task), owner);
+                continue;
+            }
+
+            // Every remaining chunk is running on another thread; wait, but keep looking for split-off ranges
+            if (!waiting) {
+                waiting.emplace("Wait for chunks", "wait");
+            }
+            std::unique_lock<std::mutex> lock(loop->mutex);
+            loop->finished.wait_for(lock, CALLER_POLL_INTERVAL, [&] { return loop->isFinished(); });
+        }
+    }
+
+    if (loop->error) {
+        std::rethrow_exception(loop->error);
+    }
+}
+
+std::vector<WorkerStats> ParallelExecutor::workerStats() const {
+    std::vector<WorkerStats> stats;
+    for (const auto &worker : workers) {
+        WorkerStats entry;
+        entry.chunks = worker->chunks.load();
+        entry.steals = worker->steals.load();
+        entry.busySeconds = worker->busyNanoseconds.load() * 1e-9;
+        entry.idleSeconds = worker->idleNanoseconds.load() * 1e-9;
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+void ParallelExecutor::resetStats() {
+    for (auto &worker : workers) {
+        worker->chunks = 0;
+        worker->steals = 0;
+        worker->busyNanoseconds = 0;
+        worker->idleNanoseconds = 0;
+    }
+}
+
+// Shared executor --------------------------------------------------------------
+
+static std::mutex sharedExecutorMutex;
+static std::shared_ptr<ParallelExecutor> sharedExecutorInstance;
+static int sharedExecutorThreads = 0;
+
+static std::shared_ptr<ParallelExecutor> sharedExecutor() {
+    std::lock_guard<std::mutex> lock(sharedExecutorMutex);
+    if (!sharedExecutorInstance) {
+        sharedExecutorInstance = std::make_shared<ParallelExecutor>(sharedExecutorThreads);
+    }
+    return sharedExecutorInstance;
+}
+
+void setParallelThreadCount(int threadCount) {
+    std::lock_guard<std::mutex> lock(sharedExecutorMutex);
+    sharedExecutorThreads = std::max(threadCount, 0);
+    sharedExecutorInstance.reset();     // Rebuilt on next use; running loops hold their own reference
+}
+
+int parallelThreadCount() {
+    return sharedExecutor()->threadCount();
+}
+
+std::vector<WorkerStats> parallelWorkerStats() {
+    return sharedExecutor()->workerStats();
+}
+
+void resetParallelWorkerStats() {
+    sharedExecutor()->resetStats();
+}
+
+void parallelFor(int begin, int end, int minChunk, const ParallelBody &body) {
+    // Holding a reference keeps the pool alive for this loop even if the thread count changes meanwhile
+    std::shared_ptr<ParallelExecutor> executor = sharedExecutor();
+    executor->parallelFor(begin, end, minChunk, body);
+}
@@ -0,0 +1,106 @@
+#ifndef PARALLEL_EXECUTOR_H
+#define PARALLEL_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Body of a parallel loop: handles the half-open range [begin, end)
+using ParallelBody = std::function<void(int begin, int end)>;
+
+// What one worker thread has done since the executor started (or since resetStats())
+struct WorkerStats {
+    uint64_t chunks = 0;            // Chunks run
+    uint64_t steals = 0;            // Tasks taken from another worker's deque
+    double busySeconds = 0.0;       // Time spent running chunks
+    double idleSeconds = 0.0;       // Time spent waiting for work
+
+    // Share of the measured time spent running chunks, 0 when nothing was measured
+    double utilization() const {
+        double total = busySeconds + idleSeconds;
+        return total > 0.0 ? busySeconds / total : 0.0;
+    }
+};
+
+/**
+ * @brief A fixed pool of threads that runs loops split into contiguous chunks, with work stealing.
+ *
+ * parallelFor() cuts [begin, end) into chunks and hands them to the pool; the calling
+ * thread works on chunks too and returns once every chunk is done. Kernels use it for
+ * row bands (each band recomputes the halo rows it needs above and below), column strips
+ * or tiles, so every chunk writes its own part of the output and needs no locking.
+ *
+ * Every worker owns a deque of chunk ranges. A worker splits the range it takes in half,
+ * keeps the lower half and pushes the upper half back onto its own deque, down to single
+ * chunks; an idle worker steals the oldest (largest) range from the back of another deque.
+ * So a worker stuck in an expensive part of the image (textured rows for the median,
+ * many edges for Canny) sheds the rest of its range to the others instead of holding it.
+ *
+ * Chunks run under the caller's ProcessingContext. After each chunk the loop reports
+ * progress for the whole range and checks for cancellation; the first exception a chunk
+ * throws (OperationCancelled included) skips the chunks not yet started and is rethrown
+ * to the caller. Loops may be nested and several threads may run loops at once.
+ */
+class ParallelExecutor {
+public:
+    // threadCount counts the calling thread; 0 means one thread per core
+    explicit ParallelExecutor(int threadCount = 0);
+    ~ParallelExecutor();
+
+    ParallelExecutor(const ParallelExecutor &) = delete;
+    ParallelExecutor &operator=(const ParallelExecutor &) = delete;
+
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    /**
+     * @brief Runs body over [begin, end) in chunks of at least minChunk items.
+     *
+     * Chunks are sized so each thread gets several (for load balance and for progress
+     * and cancellation granularity); minChunk keeps them large enough to amortise the
+     * halo a band kernel has to recompute.
+     */
+    void parallelFor(int begin, int end, int minChunk, const ParallelBody &body);
+
+    // Per-worker counters, one entry per pool thread (chunks the callers run themselves are not included)
+    std::vector<WorkerStats> workerStats() const;
+    void resetStats();
+
+private:
+    struct Loop;
+    struct Task;
+    struct Worker;
+
+    void workerMain(int index);
+    void push(int workerIndex, const Task &task);
+    bool popOwn(Worker &worker, Task &task);
+    bool steal(int thiefIndex, const Loop *only, Task &task);
+    void runTask(Task task, Worker *owner);
+    static void runChunk(Loop &loop, int chunk);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<int> queuedTasks{0};                // Tasks sitting in any deque
+    std::atomic<unsigned> nextWorker{0};            // Round robin for loops started outside the pool
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// Threads the shared executor runs with (0 = one per core). Loops already running keep the old pool.
+void setParallelThreadCount(int threadCount);
+int parallelThreadCount();
+
+// Worker counters of the shared executor
+std::vector<WorkerStats> parallelWorkerStats();
+void resetParallelWorkerStats();
+
+// ParallelExecutor::parallelFor on the shared executor
+void parallelFor(int begin, int end, int minChunk, const ParallelBody &body);
+
+#endif // PARALLEL_EXECUTOR_H
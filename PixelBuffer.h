@@ -0,0 +1,66 @@
+#ifndef PIXEL_BUFFER_H
+#define PIXEL_BUFFER_H
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+
+/**
+ * @brief Reference-counted pixel storage with copy-on-write.
+ *
+ * Copying a PixelBuffer shares the pixels instead of copying them, so taking a snapshot of an
+ * image (undo/redo, the input of a background job) costs a reference count, whatever the image
+ * size. The first write through a buffer that is still shared gives that buffer a private copy
+ * first; the other holders keep seeing the old pixels.
+ *
+ * It keeps the std::optional<std::vector<uint8_t>> interface ImageReadResult::buffer used to
+ * have: it may be empty, `*buffer` / `buffer->` reach the vector, and a vector can be assigned
+ * to it. Read-only access goes through a const buffer and never copies; non-const access is
+ * taken to mean a write and unshares the pixels. Separate PixelBuffer objects sharing the same
+ * pixels may be used from different threads, but one object must not be written and read from
+ * two threads at once.
+ */
+class PixelBuffer {
+public:
+    PixelBuffer() = default;
+    PixelBuffer(std::nullopt_t) {}
+    PixelBuffer(std::vector<uint8_t> pixels)
+        : shared(std::make_shared<std::vector<uint8_t>>(std::move(pixels))) {}
+
+    PixelBuffer &operator=(std::nullopt_t) {
+        shared.reset();
+        return *this;
+    }
+
+    bool has_value() const { return shared != nullptr; }
+    explicit operator bool() const { return has_value(); }
+    void reset() { shared.reset(); }
+
+    // Read access, shared with every copy of this buffer
+    const std::vector<uint8_t> &operator*() const { return *shared; }
+    const std::vector<uint8_t> *operator->() const { return shared.get(); }
+    const std::vector<uint8_t> &value() const { return *shared; }
+
+    // Write access, private to this buffer from here on
+    std::vector<uint8_t> &operator*() { detach(); return *shared; }
+    std::vector<uint8_t> *operator->() { detach(); return shared.get(); }
+    std::vector<uint8_t> &value() { detach(); return *shared; }
+
+    // True if both buffers hold the same pixels, i.e. neither has been written since one was copied from the other
+    bool sharesWith(const PixelBuffer &other) const { return shared && shared == other.shared; }
+
+    // Number of buffers holding these pixels (0 when empty)
+    long useCount() const { return shared.use_count(); }
+
+private:
+    void detach() {
+        if (shared && shared.use_count() > 1) {
+            shared = std::make_shared<std::vector<uint8_t>>(*shared);
+        }
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> shared;
+};
+
+#endif // PIXEL_BUFFER_H
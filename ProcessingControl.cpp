@@ -0,0 +1,71 @@
+#include "ProcessingControl.h"
+
+// Per-thread state: the installed context and the part of 0..100% the current stage covers
+static thread_local ProcessingState threadState;
+
+ProcessingScope::ProcessingScope(ProcessingContext *context)
+    : previous(threadState) {
+    threadState = ProcessingState();
+    threadState.context = context;
+}
+
+ProcessingScope::ProcessingScope(const ProcessingState &state)
+    : previous(threadState) {
+    threadState = state;
+}
+
+ProcessingScope::~ProcessingScope() {
+    threadState = previous;
+}
+
+ProgressStage::ProgressStage(int index, int count)
+    : previousBegin(threadState.begin), previousEnd(threadState.end) {
+    double span = (previousEnd - previousBegin) / (count > 0 ? count : 1);
+    threadState.begin = previousBegin + span * index;
+    threadState.end = threadState.begin + span;
+}
+
+ProgressStage::~ProgressStage() {
+    threadState.begin = previousBegin;
+    threadState.end = previousEnd;
+}
+
+ProcessingContext *currentProcessingContext() {
+    return threadState.context;
+}
+
+ProcessingState currentProcessingState() {
+    return threadState;
+}
+
+void throwIfCancelled() {
+    ProcessingContext *context = threadState.context;
+    if (context && context->cancelled.load(std::memory_order_relaxed)) {
+        throw OperationCancelled();
+    }
+}
+
+void reportProgress(long long done, long long total) {
+    ProcessingContext *context = threadState.context;
+    if (!context) {
+        return;
+    }
+    if (context->cancelled.load(std::memory_order_relaxed)) {
+        throw OperationCancelled();
+    }
+
+    double fraction = (total > 0) ? static_cast<double>(done) / total : 1.0;
+    int percent = static_cast<int>(100.0 * (threadState.begin + (threadState.end - threadState.begin) * fraction));
+
+    // Only the thread that moves the value on calls back, once per percentage step. Threads
+    // sharing the context can finish out of order, so a lower value never replaces a higher one.
+    int previous = context->percent.load(std::memory_order_relaxed);
+    while (percent > previous) {
+        if (context->percent.compare_exchange_weak(previous, percent)) {
+            if (context->onProgress) {
+                context->onProgress(percent);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef PROCESSING_CONTROL_H
+#define PROCESSING_CONTROL_H
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+/**
+ * @brief Thrown out of an operation whose ProcessingContext was cancelled.
+ *
+ * Backend wrappers let it through unchanged, so callers can tell a cancelled
+ * operation from a failed one.
+ */
+class OperationCancelled : public std::runtime_error {
+public:
+    OperationCancelled() : std::runtime_error("Operation cancelled") {}
+};
+
+/**
+ * @brief Cancellation flag and progress sink shared by an operation and whoever waits for it.
+ *
+ * The operation runs with the context installed on its thread (see ProcessingScope),
+ * checks the flag at row boundaries and reports how far it got. cancel() may be
+ * called from any thread.
+ */
+struct ProcessingContext {
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> percent{-1};           // Last progress reported, -1 before the first report
+
+    // Called on the processing thread whenever the progress percentage changes
+    std::function<void(int)> onProgress;
+
+    void cancel() { cancelled = true; }
+};
+
+/**
+ * @brief What a thread is running under: the context and the part of 0..100% its current stage covers.
+ *
+ * Captured with currentProcessingState() and installed on helper threads with a
+ * ProcessingScope, so work split across threads reports and cancels like the caller.
+ */
+struct ProcessingState {
+    ProcessingContext *context = nullptr;
+    double begin = 0.0;
+    double end = 1.0;
+};
+
+/**
+ * @brief Installs a context for the operations run on this thread while the scope lives.
+ *
+ * Scopes nest; the previous context is restored on destruction. Without a scope,
+ * operations run uncancellable and report nothing.
+ */
+class ProcessingScope {
+public:
+    explicit ProcessingScope(ProcessingContext *context);
+    explicit ProcessingScope(const ProcessingState &state);
+    ~ProcessingScope();
+
+    ProcessingScope(const ProcessingScope &) = delete;
+    ProcessingScope &operator=(const ProcessingScope &) = delete;
+
+private:
+    ProcessingState previous;
+};
+
+/**
+ * @brief Maps progress reported inside the scope to stage `index` of `count` equal stages.
+ *
+ * Lets a multi-pass operation (or one built from other operations) report 0..100%
+ * overall while each pass reports its own rows.
+ */
+class ProgressStage {
+public:
+    ProgressStage(int index, int count);
+    ~ProgressStage();
+
+    ProgressStage(const ProgressStage &) = delete;
+    ProgressStage &operator=(const ProgressStage &) = delete;
+
+private:
+    double previousBegin;
+    double previousEnd;
+};
+
+// Context installed on this thread, or nullptr
+ProcessingContext *currentProcessingContext();
+
+// Context and progress stage of this thread
+ProcessingState currentProcessingState();
+
+// Throws OperationCancelled if the current context was cancelled
+void throwIfCancelled();
+
+/**
+ * @brief Reports that `done` of `total` units of the current stage are finished.
+ *
+ * Also the point where a cancelled operation stops: throws OperationCancelled if
+ * the current context was cancelled. Costs a couple of loads when nothing changed,
+ * so it can be called once per row. May be called from several threads at once;
+ * the reported percentage only moves forwards.
+ */
+void reportProgress(long long done, long long total);
+
+#endif // PROCESSING_CONTROL_H
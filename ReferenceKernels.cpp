@@ -0,0 +1,449 @@
+#include "ReferenceKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+static void checkImage(const ImageReadResult& inputImage) {
+    if (!inputImage.meta.isValid() || !inputImage.buffer.has_value()) {
+        throw std::invalid_argument("Invalid image metadata or missing buffer!");
+    }
+}
+
+// Pixel (r, c) of a rows x cols image, which may lie up to a few pixels outside it.
+// NONE and ZERO read 0 outside; REFLECT mirrors with the edge pixel repeated (-1 -> 0).
+static uint8_t paddedPixel(const uint8_t* buffer, int rows, int cols, int r, int c, PaddingChoice paddingChoice) {
+    if (r >= 0 && r < rows && c >= 0 && c < cols) {
+        return buffer[r * cols + c];
+    }
+
+    switch (paddingChoice) {
+        case PaddingChoice::REPLICATE:
+            r = std::clamp(r, 0, rows - 1);
+            c = std::clamp(c, 0, cols - 1);
+            return buffer[r * cols + c];
+        case PaddingChoice::REFLECT:
+            if (r < 0)      r = -r - 1;
+            if (r >= rows)  r = 2 * rows - r - 1;
+            if (c < 0)      c = -c - 1;
+            if (c >= cols)  c = 2 * cols - c - 1;
+            return buffer[std::clamp(r, 0, rows - 1) * cols + std::clamp(c, 0, cols - 1)];
+        default:
+            return 0;
+    }
+}
+
+// Filters ----------------------------------------------------------------------------------
+
+std::vector<uint8_t> referenceBoxFilter(const ImageReadResult& inputImage, int kernelSize) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+    int halfKernel = kernelSize / 2;
+
+    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            int sum = 0;
+            int count = 0;
+
+            // Only pixels inside the image count, so the window shrinks at the borders
+            for (int ki = -halfKernel; ki <= halfKernel; ++ki) {
+                for (int kj = -halfKernel; kj <= halfKernel; ++kj) {
+                    int x = i + ki;
+                    int y = j + kj;
+                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
+                        sum += buffer[x * cols + y];
+                        count++;
+                    }
+                }
+            }
+
+            outputBuffer[i * cols + j] = static_cast<uint8_t>(sum / count);
+        }
+    }
+    return outputBuffer;
+}
+
+std::vector<uint8_t> referenceGaussianFilter(const ImageReadResult& inputImage, int kernelSize, double sigma) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+    int halfKernel = kernelSize / 2;
+    int size = 2 * halfKernel + 1;
+
+    // Full 2D kernel, normalized
+    std::vector<double> kernel(size * size);
+    double sum = 0.0;
+    for (int i = -halfKernel; i <= halfKernel; ++i) {
+        for (int j = -halfKernel; j <= halfKernel; ++j) {
+            double value = std::exp(-(i * i + j * j) / (2 * sigma * sigma)) / (2 * M_PI * sigma * sigma);
+            kernel[(i + halfKernel) * size + (j + halfKernel)] = value;
+            sum += value;
+        }
+    }
+    for (double& value : kernel) {
+        value /= sum;
+    }
+
+    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            double weightedSum = 0.0;
+            double weightSum = 0.0;
+
+            for (int ki = -halfKernel; ki <= halfKernel; ++ki) {
+                for (int kj = -halfKernel; kj <= halfKernel; ++kj) {
+                    int x = i + ki;
+                    int y = j + kj;
+                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
+                        double weight = kernel[(ki + halfKernel) * size + (kj + halfKernel)];
+                        weightedSum += buffer[x * cols + y] * weight;
+                        weightSum += weight;
+                    }
+                }
+            }
+
+            outputBuffer[i * cols + j] = static_cast<uint8_t>(weightedSum / weightSum);
+        }
+    }
+    return outputBuffer;
+}
+
+std::vector<uint8_t> referenceMedianFilter(const ImageReadResult& inputImage, int kernelSize) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+    int halfKernel = kernelSize / 2;
+
+    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    std::vector<uint8_t> window;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            window.clear();
+            for (int ki = -halfKernel; ki <= halfKernel; ++ki) {
+                for (int kj = -halfKernel; kj <= halfKernel; ++kj) {
+                    int x = i + ki;
+                    int y = j + kj;
+                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
+                        window.push_back(buffer[x * cols + y]);
+                    }
+                }
+            }
+
+            std::nth_element(window.begin(), window.begin() + window.size() / 2, window.end());
+            outputBuffer[i * cols + j] = window[window.size() / 2];
+        }
+    }
+    return outputBuffer;
+}
+
+std::vector<uint8_t> referenceHighPassFilter(const ImageReadResult& inputImage, int kernelChoice) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+
+    static const int kernels[5][3][3] = {
+        {{0, 1, 0}, {1, -4, 1}, {0, 1, 0}},             // Basic Laplacian
+        {{1, 1, 1}, {1, -8, 1}, {1, 1, 1}},             // Full Laplacian
+        {{0, -1, 0}, {-1, 4, -1}, {0, -1, 0}},          // Basic inverted Laplacian
+        {{-1, -1, -1}, {-1, 8, -1}, {-1, -1, -1}},      // Full inverted Laplacian
+        {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}}            // Sobel
+    };
+    if (kernelChoice < 1 || kernelChoice > 5) {
+        throw std::invalid_argument("Invalid kernel choice! Type a valid number");
+    }
+    const int (*kernel)[3] = kernels[kernelChoice - 1];
+
+    // The one-pixel border is left at 0
+    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    for (int i = 1; i < rows - 1; ++i) {
+        for (int j = 1; j < cols - 1; ++j) {
+            int sum = 0;
+            for (int ki = -1; ki <= 1; ++ki) {
+                for (int kj = -1; kj <= 1; ++kj) {
+                    sum += buffer[(i + ki) * cols + (j + kj)] * kernel[ki + 1][kj + 1];
+                }
+            }
+            outputBuffer[i * cols + j] = std::clamp(sum, 0, 255);
+        }
+    }
+    return outputBuffer;
+}
+
+std::vector<uint8_t> referenceImageSharpening(const ImageReadResult& inputImage, int kernelChoice) {
+    int c = (kernelChoice == 1 || kernelChoice == 2) ? -1 : ((kernelChoice == 3 || kernelChoice == 4) ? 1 : 0);
+
+    std::vector<uint8_t> filteredBuffer = referenceHighPassFilter(inputImage, kernelChoice);
+    const uint8_t* buffer = inputImage.buffer->data();
+
+    std::vector<uint8_t> outputBuffer(filteredBuffer.size());
+    for (size_t i = 0; i < outputBuffer.size(); ++i) {
+        outputBuffer[i] = std::clamp(static_cast<int>(buffer[i]) + c * static_cast<int>(filteredBuffer[i]), 0, 255);
+    }
+    return outputBuffer;
+}
+
+// Morphology -------------------------------------------------------------------------------
+
+// Minimum (erode) or maximum of the kernelColumns x kernelRows window, clipped to the image
+static std::vector<uint8_t> rankFilter(const ImageReadResult& inputImage, int kernelColumns, int kernelRows, bool erode) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+    int halfKernelColumns = kernelColumns / 2;
+    int halfKernelRows = kernelRows / 2;
+
+    std::vector<uint8_t> outputBuffer(rows * cols, 0);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            uint8_t value = erode ? 255 : 0;
+            for (int ki = -halfKernelRows; ki <= halfKernelRows; ++ki) {
+                for (int kj = -halfKernelColumns; kj <= halfKernelColumns; ++kj) {
+                    int x = i + ki;
+                    int y = j + kj;
+                    if (x >= 0 && x < rows && y >= 0 && y < cols) {
+                        value = erode ? std::min(value, buffer[x * cols + y]) : std::max(value, buffer[x * cols + y]);
+                    }
+                }
+            }
+            outputBuffer[i * cols + j] = value;
+        }
+    }
+    return outputBuffer;
+}
+
+std::vector<uint8_t> referenceErosion(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return rankFilter(inputImage, kernelColumns, kernelRows, true);
+}
+
+std::vector<uint8_t> referenceDilation(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    return rankFilter(inputImage, kernelColumns, kernelRows, false);
+}
+
+std::vector<uint8_t> referenceOpening(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    ImageReadResult tempImage = inputImage;
+    tempImage.buffer = referenceErosion(inputImage, kernelColumns, kernelRows);
+    return referenceDilation(tempImage, kernelColumns, kernelRows);
+}
+
+std::vector<uint8_t> referenceClosing(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    ImageReadResult tempImage = inputImage;
+    tempImage.buffer = referenceDilation(inputImage, kernelColumns, kernelRows);
+    return referenceErosion(tempImage, kernelColumns, kernelRows);
+}
+
+std::vector<uint8_t> referenceBoundaryExtraction(const ImageReadResult& inputImage, int kernelColumns, int kernelRows) {
+    std::vector<uint8_t> erodedImage = referenceErosion(inputImage, kernelColumns, kernelRows);
+    const uint8_t* buffer = inputImage.buffer->data();
+
+    std::vector<uint8_t> outputBuffer(erodedImage.size());
+    for (size_t i = 0; i < outputBuffer.size(); ++i) {
+        outputBuffer[i] = static_cast<uint8_t>(std::max(0, static_cast<int>(buffer[i]) - static_cast<int>(erodedImage[i])));
+    }
+    return outputBuffer;
+}
+
+// Edge detection ---------------------------------------------------------------------------
+
+std::vector<uint8_t> referenceGradientEdgeDetection(const ImageReadResult& inputImage, KernelChoice kernelChoice,
+                                                    bool applyThreshold, double thresholdValue,
+                                                    PaddingChoice paddingChoice) {
+    checkImage(inputImage);
+    const uint8_t* buffer = inputImage.buffer->data();
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+
+    static const int sobelX[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+    static const int sobelY[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+    static const int prewittX[3][3] = {{-1, 0, 1}, {-1, 0, 1}, {-1, 0, 1}};
+    static const int prewittY[3][3] = {{-1, -1, -1}, {0, 0, 0}, {1, 1, 1}};
+    static const int robertsX[2][2] = {{1, 0}, {0, -1}};
+    static const int robertsY[2][2] = {{0, 1}, {-1, 0}};
+
+    const int (*gx)[3] = nullptr;
+    const int (*gy)[3] = nullptr;
+    switch (kernelChoice) {
+        case KernelChoice::SOBEL:   gx = sobelX;   gy = sobelY;   break;
+        case KernelChoice::PREWITT: gx = prewittX; gy = prewittY; break;
+        case KernelChoice::ROBERTS: break;
+        default:
+            throw std::invalid_argument("Unknown kernel choice!");
+    }
+
+    std::vector<float> gradientMagnitudes(rows * cols, 0.0f);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            float sumX = 0.f;
+            float sumY = 0.f;
+
+            if (kernelChoice == KernelChoice::ROBERTS) {
+                // 2x2 operator anchored at its top-left pixel
+                for (int ki = 0; ki < 2; ++ki) {
+                    for (int kj = 0; kj < 2; ++kj) {
+                        uint8_t pixelVal = paddedPixel(buffer, rows, cols, i + ki, j + kj, paddingChoice);
+                        sumX += pixelVal * robertsX[ki][kj];
+                        sumY += pixelVal * robertsY[ki][kj];
+                    }
+                }
+            } else {
+                for (int ki = -1; ki <= 1; ++ki) {
+                    for (int kj = -1; kj <= 1; ++kj) {
+                        uint8_t pixelVal = paddedPixel(buffer, rows, cols, i + ki, j + kj, paddingChoice);
+                        sumX += pixelVal * gx[ki + 1][kj + 1];
+                        sumY += pixelVal * gy[ki + 1][kj + 1];
+                    }
+                }
+            }
+            gradientMagnitudes[i * cols + j] = std::sqrt(sumX * sumX + sumY * sumY);
+        }
+    }
+
+    std::vector<uint8_t> output(rows * cols, 0);
+    if (applyThreshold) {
+        for (int i = 0; i < rows * cols; ++i) {
+            output[i] = (gradientMagnitudes[i] >= thresholdValue) ? 255 : 0;
+        }
+        return output;
+    }
+
+    // Otherwise stretch the magnitudes to 0..255
+    float minVal = *std::min_element(gradientMagnitudes.begin(), gradientMagnitudes.end());
+    float maxVal = *std::max_element(gradientMagnitudes.begin(), gradientMagnitudes.end());
+    float range = maxVal - minVal;
+    if (range >= 1e-5) {
+        for (int i = 0; i < rows * cols; ++i) {
+            float scaledVal = (gradientMagnitudes[i] - minVal) / range * 255.0f;
+            output[i] = static_cast<uint8_t>(std::clamp(scaledVal, 0.0f, 255.0f));
+        }
+    }
+    return output;
+}
+
+std::vector<uint8_t> referenceCannyEdgeDetection(const ImageReadResult& inputImage, double lowThreshold,
+                                                 double highThreshold, double sigma, int kernelSize,
+                                                 PaddingChoice paddingChoice) {
+    checkImage(inputImage);
+    int rows = inputImage.meta.height;
+    int cols = inputImage.meta.width;
+
+    // 1. Gaussian smoothing
+    std::vector<uint8_t> smoothed = referenceGaussianFilter(inputImage, kernelSize, sigma);
+
+    // 2. Sobel gradients of the smoothed image
+    static const int gx[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+    static const int gy[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+    std::vector<float> gradientMagnitude(rows * cols, 0.0f);
+    std::vector<float> gradientDirection(rows * cols, 0.0f);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            float sumX = 0.f;
+            float sumY = 0.f;
+            for (int ki = -1; ki <= 1; ++ki) {
+                for (int kj = -1; kj <= 1; ++kj) {
+                    uint8_t pixelVal = paddedPixel(smoothed.data(), rows, cols, i + ki, j + kj, paddingChoice);
+                    sumX += pixelVal * gx[ki + 1][kj + 1];
+                    sumY += pixelVal * gy[ki + 1][kj + 1];
+                }
+            }
+            gradientMagnitude[i * cols + j] = std::sqrt(sumX * sumX + sumY * sumY);
+            gradientDirection[i * cols + j] = std::atan2(sumY, sumX) * 180 / M_PI;
+        }
+    }
+
+    // 3. Non-maximum suppression along the gradient direction; the border stays 0
+    std::vector<float> suppressed(rows * cols, 0.0f);
+    for (int i = 1; i < rows - 1; ++i) {
+        for (int j = 1; j < cols - 1; ++j) {
+            float angle = std::fmod(gradientDirection[i * cols + j] + 180.0, 180.0);
+            float magnitude = gradientMagnitude[i * cols + j];
+            float neighbor1 = 0.0f, neighbor2 = 0.0f;
+
+            if ((angle >= 0 && angle < 22.5) || (angle >= 157.5 && angle <= 180)) {
+                neighbor1 = gradientMagnitude[i * cols + (j + 1)];
+                neighbor2 = gradientMagnitude[i * cols + (j - 1)];
+            } else if (angle >= 22.5 && angle < 67.5) {
+                neighbor1 = gradientMagnitude[(i + 1) * cols + (j - 1)];
+                neighbor2 = gradientMagnitude[(i - 1) * cols + (j + 1)];
+            } else if (angle >= 67.5 && angle < 112.5) {
+                neighbor1 = gradientMagnitude[(i + 1) * cols + j];
+                neighbor2 = gradientMagnitude[(i - 1) * cols + j];
+            } else if (angle >= 112.5 && angle < 157.5) {
+                neighbor1 = gradientMagnitude[(i - 1) * cols + (j - 1)];
+                neighbor2 = gradientMagnitude[(i + 1) * cols + (j + 1)];
+            }
+
+            if (magnitude >= neighbor1 && magnitude >= neighbor2) {
+                suppressed[i * cols + j] = magnitude;
+            }
+        }
+    }
+
+    // 4. Double threshold
+    const uint8_t strongEdge = 255;
+    const uint8_t weakEdge = 75;
+    std::vector<uint8_t> output(rows * cols, 0);
+    for (int i = 0; i < rows * cols; ++i) {
+        output[i] = suppressed[i] >= highThreshold ? strongEdge : suppressed[i] >= lowThreshold ? weakEdge : 0;
+    }
+
+    // 5. One raster pass of hysteresis: a weak edge survives if a neighbour is strong by now
+    for (int i = 1; i < rows - 1; ++i) {
+        for (int j = 1; j < cols - 1; ++j) {
+            if (output[i * cols + j] != weakEdge) {
+                continue;
+            }
+
+            bool strongNeighbor = false;
+            for (int dr = -1; dr <= 1; ++dr) {
+                for (int dc = -1; dc <= 1; ++dc) {
+                    strongNeighbor = strongNeighbor || output[(i + dr) * cols + (j + dc)] == strongEdge;
+                }
+            }
+            output[i * cols + j] = strongNeighbor ? strongEdge : 0;
+        }
+    }
+    return output;
+}
+
+// Point operations -------------------------------------------------------------------------
+
+std::vector<uint8_t> referenceGrayscaleToBinary(const ImageReadResult& inputImage, int threshold) {
+    checkImage(inputImage);
+    const std::vector<uint8_t>& buffer = *inputImage.buffer;
+
+    std::vector<uint8_t> outputBuffer(buffer.size());
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        outputBuffer[i] = (buffer[i] > threshold) ? 255 : 0;
+    }
+    return outputBuffer;
+}
+
+void referenceNegative(uint8_t *buffer, const ImageMetadata &meta) {
+    int maxVal = (1 << meta.bitDepth) - 1;
+    for (int i = 0; i < meta.width * meta.height; i++) {
+        buffer[i] = maxVal - buffer[i];
+    }
+}
+
+void referenceLogTransform(uint8_t *buffer, const ImageMetadata &meta, double c) {
+    int maxVal = (1 << meta.bitDepth) - 1;
+    for (int i = 0; i < meta.width * meta.height; i++) {
+        double transformedValue = std::min(c * std::log(1 + buffer[i]), static_cast<double>(maxVal));
+        buffer[i] = static_cast<uint8_t>(transformedValue);
+    }
+}
+
+void referenceGammaTransform(uint8_t *buffer, const ImageMetadata &meta, double c, double gamma) {
+    int maxVal = (1 << meta.bitDepth) - 1;
+    for (int i = 0; i < meta.width * meta.height; i++) {
+        double transformedValue = std::min(c * std::pow(buffer[i], gamma), static_cast<double>(maxVal));
+        buffer[i] = static_cast<uint8_t>(transformedValue);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef REFERENCE_KERNELS_H
+#define REFERENCE_KERNELS_H
+
+#include <vector>
+#include <cstdint>
+
+#include "ImageIO.h"
+#include "ImageUtils.h"     // KernelChoice, PaddingChoice
+
+/*
+ * Reference kernels -----------------------------------------------------------------------
+ *
+ * The original per-pixel loops of the filters, morphology, edge detection and intensity
+ * transforms, kept unoptimized as the ground truth the fast kernels are checked against
+ * (ImageBenchmark --verify). They take the same arguments and return the same images as
+ * the apply* functions they mirror, but share no code with them: padding is read directly
+ * from the source pixels rather than through ImageUtils. Slow on purpose; not for real work.
+ */
+
+std::vector<uint8_t> referenceBoxFilter(const ImageReadResult& inputImage, int kernelSize);
+std::vector<uint8_t> referenceGaussianFilter(const ImageReadResult& inputImage, int kernelSize, double sigma);
+std::vector<uint8_t> referenceMedianFilter(const ImageReadResult& inputImage, int kernelSize);
+std::vector<uint8_t> referenceHighPassFilter(const ImageReadResult& inputImage, int kernelChoice);
+std::vector<uint8_t> referenceImageSharpening(const ImageReadResult& inputImage, int kernelChoice);
+
+std::vector<uint8_t> referenceErosion(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
+std::vector<uint8_t> referenceDilation(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
+std::vector<uint8_t> referenceOpening(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
+std::vector<uint8_t> referenceClosing(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
+std::vector<uint8_t> referenceBoundaryExtraction(const ImageReadResult& inputImage, int kernelColumns, int kernelRows);
+
+std::vector<uint8_t> referenceGradientEdgeDetection(const ImageReadResult& inputImage, KernelChoice kernelChoice,
+                                                    bool applyThreshold, double thresholdValue,
+                                                    PaddingChoice paddingChoice);
+std::vector<uint8_t> referenceCannyEdgeDetection(const ImageReadResult& inputImage, double lowThreshold,
+                                                 double highThreshold, double sigma, int kernelSize,
+                                                 PaddingChoice paddingChoice);
+
+std::vector<uint8_t> referenceGrayscaleToBinary(const ImageReadResult& inputImage, int threshold);
+
+// In place, like applyNegative and friends
+void referenceNegative(uint8_t *buffer, const ImageMetadata &meta);
+void referenceLogTransform(uint8_t *buffer, const ImageMetadata &meta, double c);
+void referenceGammaTransform(uint8_t *buffer, const ImageMetadata &meta, double c, double gamma);
+
+#endif // REFERENCE_KERNELS_H
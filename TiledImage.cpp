@@ -0,0 +1,384 @@
+#include "TiledImage.h"
+#include "ParallelExecutor.h"
+#include "ProcessingControl.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Scratch file ---------------------------------------------------------------------------
+
+// Tile offsets in the scratch file easily pass 2 GB, so use the 64-bit seek of each platform
+static bool seekScratch(std::FILE *file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// Tiled image ----------------------------------------------------------------------------
+
+TiledImage::TiledImage(const ImageMetadata &meta, int tileSize, size_t cacheTiles)
+    : metadata(meta), tileEdge(tileSize), cacheCapacity(std::max<size_t>(cacheTiles, 1)) {
+    if (!meta.isValid() || meta.bitDepth % 8 != 0 || tileSize <= 0) {
+        throw std::invalid_argument("Invalid image metadata or tile size!");
+    }
+
+    tilesAcross = (meta.width + tileSize - 1) / tileSize;
+    tilesDown = (meta.height + tileSize - 1) / tileSize;
+    onDisk.assign(static_cast<size_t>(tilesAcross) * tilesDown, false);
+
+    // tmpfile() is removed automatically when it is closed or the process exits
+    scratch.reset(std::tmpfile());
+    if (!scratch) {
+        throw std::runtime_error("Failed to create scratch file for tiled image!");
+    }
+}
+
+TiledImage::~TiledImage() = default;
+
+TiledImage TiledImage::emptyLike() const {
+    TiledImage image(metadata, tileEdge, cacheCapacity);
+    image.header = header;
+    image.colorTable = colorTable;
+    return image;
+}
+
+void TiledImage::checkRegion(int x, int y, int w, int h) const {
+    if (!isValid()) {
+        throw std::invalid_argument("Tiled image is not initialised!");
+    }
+    if (x < 0 || y < 0 || w < 0 || h < 0 || x + w > metadata.width || y + h > metadata.height) {
+        throw std::out_of_range("Region lies outside the tiled image!");
+    }
+}
+
+void TiledImage::evictTile() const {
+    int index = lru.back();
+    Tile &tile = tiles.at(index);
+
+    if (tile.dirty) {
+        uint64_t offset = static_cast<uint64_t>(index) * tileBytes();
+        if (!seekScratch(scratch.get(), offset) ||
+            std::fwrite(tile.pixels.data(), 1, tile.pixels.size(), scratch.get()) != tile.pixels.size()) {
+            throw std::runtime_error("Failed to write tile to scratch file!");
+        }
+        onDisk[index] = true;
+    }
+
+    lru.pop_back();
+    tiles.erase(index);
+}
+
+TiledImage::Tile &TiledImage::loadTile(int index) const {
+    auto found = tiles.find(index);
+    if (found != tiles.end()) {
+        // Move to the front of the LRU list
+        lru.splice(lru.begin(), lru, found->second.lruPosition);
+        return found->second;
+    }
+
+    while (tiles.size() >= cacheCapacity) {
+        evictTile();
+    }
+
+    Tile tile;
+    tile.pixels.assign(tileBytes(), 0);
+    if (onDisk[index]) {
+        uint64_t offset = static_cast<uint64_t>(index) * tileBytes();
+        if (!seekScratch(scratch.get(), offset) ||
+            std::fread(tile.pixels.data(), 1, tile.pixels.size(), scratch.get()) != tile.pixels.size()) {
+            throw std::runtime_error("Failed to read tile from scratch file!");
+        }
+    }
+
+    lru.push_front(index);
+    tile.lruPosition = lru.begin();
+    return tiles.emplace(index, std::move(tile)).first->second;
+}
+
+void TiledImage::readRegion(int x, int y, int w, int h, uint8_t *destination) const {
+    checkRegion(x, y, w, h);
+    std::lock_guard<std::mutex> lock(*mutex);
+
+    size_t pixelBytes = bytesPerPixel();
+    size_t destinationStride = static_cast<size_t>(w) * pixelBytes;
+    size_t tileStride = static_cast<size_t>(tileEdge) * pixelBytes;
+
+    for (int tileRow = y / tileEdge; tileRow * tileEdge < y + h; ++tileRow) {
+        for (int tileColumn = x / tileEdge; tileColumn * tileEdge < x + w; ++tileColumn) {
+            const Tile &tile = loadTile(tileRow * tilesAcross + tileColumn);
+
+            // Part of the region that falls in this tile
+            int top = std::max(y, tileRow * tileEdge);
+            int bottom = std::min(y + h, (tileRow + 1) * tileEdge);
+            int left = std::max(x, tileColumn * tileEdge);
+            int right = std::min(x + w, (tileColumn + 1) * tileEdge);
+            size_t spanBytes = static_cast<size_t>(right - left) * pixelBytes;
+
+            for (int r = top; r < bottom; ++r) {
+                const uint8_t *source = tile.pixels.data() + (r - tileRow * tileEdge) * tileStride +
+                                        (left - tileColumn * tileEdge) * pixelBytes;
+                std::memcpy(destination + (r - y) * destinationStride + (left - x) * pixelBytes, source, spanBytes);
+            }
+        }
+    }
+}
+
+void TiledImage::writeRegion(int x, int y, int w, int h, const uint8_t *source) {
+    checkRegion(x, y, w, h);
+    std::lock_guard<std::mutex> lock(*mutex);
+
+    size_t pixelBytes = bytesPerPixel();
+    size_t sourceStride = static_cast<size_t>(w) * pixelBytes;
+    size_t tileStride = static_cast<size_t>(tileEdge) * pixelBytes;
+
+    for (int tileRow = y / tileEdge; tileRow * tileEdge < y + h; ++tileRow) {
+        for (int tileColumn = x / tileEdge; tileColumn * tileEdge < x + w; ++tileColumn) {
+            Tile &tile = loadTile(tileRow * tilesAcross + tileColumn);
+            tile.dirty = true;
+
+            int top = std::max(y, tileRow * tileEdge);
+            int bottom = std::min(y + h, (tileRow + 1) * tileEdge);
+            int left = std::max(x, tileColumn * tileEdge);
+            int right = std::min(x + w, (tileColumn + 1) * tileEdge);
+            size_t spanBytes = static_cast<size_t>(right - left) * pixelBytes;
+
+            for (int r = top; r < bottom; ++r) {
+                uint8_t *destination = tile.pixels.data() + (r - tileRow * tileEdge) * tileStride +
+                                       (left - tileColumn * tileEdge) * pixelBytes;
+                std::memcpy(destination, source + (r - y) * sourceStride + (left - x) * pixelBytes, spanBytes);
+            }
+        }
+    }
+}
+
+ImageReadResult TiledImage::readRegion(int x, int y, int w, int h) const {
+    std::vector<uint8_t> buffer(static_cast<size_t>(w) * h * bytesPerPixel());
+    readRegion(x, y, w, h, buffer.data());
+
+    ImageReadResult region;
+    region.buffer = std::move(buffer);
+    region.header = header;
+    region.colorTable = colorTable;
+    region.meta = ImageMetadata(w, h, metadata.bitDepth);
+    return region;
+}
+
+// BMP streaming --------------------------------------------------------------------------
+
+TiledImage TiledImage::fromBmp(const std::string &filePath, int tileSize, size_t cacheTiles) {
+    log(INFO, "Opening file for tiled access: " + filePath);
+
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        log(ERROR, "Failed to open file: " + filePath);
+        return {};
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    // Read the header
+    std::vector<uint8_t> header(HEADER_SIZE);
+    file.read(reinterpret_cast<char *>(header.data()), HEADER_SIZE);
+    if (!file || header[0] != 'B' || header[1] != 'M') {
+        log(ERROR, "File is not a valid BMP file.");
+        return {};
+    }
+
+    auto readInt32 = [&](size_t offset) {
+        int32_t value;
+        std::memcpy(&value, header.data() + offset, sizeof(value));
+        return value;
+    };
+    auto readUint16 = [&](size_t offset) {
+        uint16_t value;
+        std::memcpy(&value, header.data() + offset, sizeof(value));
+        return value;
+    };
+
+    // Extract metadata
+    ImageMetadata meta(readInt32(18), readInt32(22), readUint16(28));
+    if (!meta.isValid()) {
+        log(ERROR, "Invalid metadata extracted from image header.");
+        return {};
+    }
+    if (meta.bitDepth != 8 && meta.bitDepth != 24) {
+        log(ERROR, "Unsupported bit depth: " + std::to_string(meta.bitDepth));
+        return {};
+    }
+
+    log(INFO, "Image Metadata: Width=" + std::to_string(meta.width) +
+                  ", Height=" + std::to_string(meta.height) +
+                  ", Bit Depth=" + std::to_string(meta.bitDepth));
+
+    // Read the color table if applicable
+    std::vector<uint8_t> colorTable;
+    if (meta.bitDepth <= 8) {
+        colorTable.resize(COLOR_TABLE_SIZE);
+        file.read(reinterpret_cast<char *>(colorTable.data()), COLOR_TABLE_SIZE);
+        if (!file) {
+            log(ERROR, "Failed to read color table.");
+            return {};
+        }
+    }
+
+    uint64_t pixelOffset = static_cast<uint32_t>(readInt32(10));
+    pixelOffset = std::max<uint64_t>(pixelOffset, HEADER_SIZE + colorTable.size());
+
+    // Rows are padded to 4 bytes in the file
+    size_t rowBytes = static_cast<size_t>(meta.width) * (meta.bitDepth / 8);
+    size_t rowSize = (rowBytes + 3) / 4 * 4;
+    if (pixelOffset > fileSize || static_cast<uint64_t>(rowSize) * meta.height > fileSize - pixelOffset) {
+        log(ERROR, "Pixel data is truncated.");
+        return {};
+    }
+
+    TiledImage image(meta, tileSize, cacheTiles);
+    image.header = std::move(header);
+    image.colorTable = std::move(colorTable);
+
+    // One band of tiles at a time, so only a row of tiles needs to be resident
+    file.seekg(static_cast<std::streamoff>(pixelOffset), std::ios::beg);
+    std::vector<uint8_t> band(rowSize * tileSize);
+    for (int y = 0; y < meta.height; y += tileSize) {
+        int bandRows = std::min(tileSize, meta.height - y);
+        file.read(reinterpret_cast<char *>(band.data()), static_cast<std::streamsize>(rowSize * bandRows));
+        if (!file) {
+            log(ERROR, "Failed to read pixel data.");
+            return {};
+        }
+
+        // Drop the row padding in place
+        for (int r = 1; r < bandRows; ++r) {
+            std::memmove(band.data() + r * rowBytes, band.data() + r * rowSize, rowBytes);
+        }
+        image.writeRegion(0, y, meta.width, bandRows, band.data());
+    }
+
+    log(INFO, "Image data successfully read.");
+    return image;
+}
+
+bool TiledImage::writeBmp(const std::string &filePath) const {
+    log(INFO, "Writing tiled image to: " + filePath);
+
+    if (!isValid() || header.size() < HEADER_SIZE) {
+        log(ERROR, "Invalid tiled image or header. Cannot write image.");
+        return false;
+    }
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file) {
+        log(ERROR, "Failed to open file for writing: " + filePath);
+        return false;
+    }
+
+    size_t rowBytes = static_cast<size_t>(metadata.width) * bytesPerPixel();
+    size_t rowSize = (rowBytes + 3) / 4 * 4;
+    uint64_t pixelOffset = HEADER_SIZE + colorTable.size();
+    uint64_t imageSize = static_cast<uint64_t>(rowSize) * metadata.height;
+
+    // Keep the header of the source file, but make the sizes and offset match what we write
+    std::vector<uint8_t> updatedHeader(header.begin(), header.begin() + HEADER_SIZE);
+    auto writeUint32 = [&](size_t offset, uint64_t value) {
+        uint32_t narrowed = static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+        std::memcpy(updatedHeader.data() + offset, &narrowed, sizeof(narrowed));
+    };
+    writeUint32(2, pixelOffset + imageSize);
+    writeUint32(10, pixelOffset);
+    writeUint32(34, imageSize);
+
+    file.write(reinterpret_cast<const char *>(updatedHeader.data()), HEADER_SIZE);
+    file.write(reinterpret_cast<const char *>(colorTable.data()), static_cast<std::streamsize>(colorTable.size()));
+
+    std::vector<uint8_t> band(rowSize * tileEdge, 0);
+    for (int y = 0; y < metadata.height; y += tileEdge) {
+        int bandRows = std::min(tileEdge, metadata.height - y);
+        readRegion(0, y, metadata.width, bandRows, band.data());
+
+        // Spread the rows out to their padded size, last row first so nothing is overwritten
+        for (int r = bandRows - 1; r > 0; --r) {
+            std::memmove(band.data() + r * rowSize, band.data() + r * rowBytes, rowBytes);
+            std::memset(band.data() + r * rowSize + rowBytes, 0, rowSize - rowBytes);
+        }
+        std::memset(band.data() + rowBytes, 0, rowSize - rowBytes);
+
+        file.write(reinterpret_cast<const char *>(band.data()), static_cast<std::streamsize>(rowSize * bandRows));
+    }
+
+    if (!file) {
+        log(ERROR, "Failed to write pixel data.");
+        return false;
+    }
+
+    log(INFO, "Image successfully written.");
+    return true;
+}
+
+// Tile-by-tile processing ----------------------------------------------------------------
+
+TiledImage processTiled(const TiledImage &inputImage, int halo,
+                        const std::function<std::vector<uint8_t>(const ImageReadResult &)> &filter) {
+    if (!inputImage.isValid()) {
+        throw std::invalid_argument("Invalid tiled image!");
+    }
+
+    TiledImage outputImage = inputImage.emptyLike();
+
+    int width = inputImage.width();
+    int height = inputImage.height();
+    int tileSize = inputImage.tileSize();
+    halo = std::max(halo, 0);
+    size_t pixelBytes = inputImage.meta().bitDepth / 8;
+
+    int tileColumns = (width + tileSize - 1) / tileSize;
+    int tileRows = (height + tileSize - 1) / tileSize;
+
+    /* Tiles are independent tasks for the work-stealing executor, so a slow textured tile does not
+       hold up the rest. Progress comes from the tile loop alone: the filters inside report into an
+       empty stage, which keeps their cancellation checks but not their per-row percentages. */
+    ProcessingState tileState = currentProcessingState();
+    tileState.end = tileState.begin;
+
+    parallelFor(0, tileColumns * tileRows, 1, [&](int tileBegin, int tileEnd) {
+        ProcessingScope scope(tileState);
+        std::vector<uint8_t> centre;
+
+        for (int tile = tileBegin; tile < tileEnd; ++tile) {
+            int x = (tile % tileColumns) * tileSize;
+            int y = (tile / tileColumns) * tileSize;
+            int tileWidth = std::min(tileSize, width - x);
+            int tileHeight = std::min(tileSize, height - y);
+            TraceSpan span("Tile", "tile", {"x", x}, {"y", y});
+
+            // Tile grown by the halo, clipped to the image so borders behave as in the whole image
+            int left = std::max(0, x - halo);
+            int top = std::max(0, y - halo);
+            int right = std::min(width, x + tileWidth + halo);
+            int bottom = std::min(height, y + tileHeight + halo);
+
+            ImageReadResult region = inputImage.readRegion(left, top, right - left, bottom - top);
+            std::vector<uint8_t> filtered = filter(region);
+
+            size_t regionStride = static_cast<size_t>(right - left) * pixelBytes;
+            if (filtered.size() != regionStride * (bottom - top)) {
+                throw std::runtime_error("Tile filter returned a buffer of the wrong size!");
+            }
+
+            // Keep only the centre of the filtered region
+            size_t centreStride = static_cast<size_t>(tileWidth) * pixelBytes;
+            centre.resize(centreStride * tileHeight);
+            for (int r = 0; r < tileHeight; ++r) {
+                std::memcpy(centre.data() + r * centreStride,
+                            filtered.data() + (y - top + r) * regionStride + (x - left) * pixelBytes, centreStride);
+            }
+            outputImage.writeRegion(x, y, tileWidth, tileHeight, centre.data());
+        }
+    });
+
+    return outputImage;
+}
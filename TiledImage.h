@@ -0,0 +1,124 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ImageIO.h"    // To use ImageMetadata / ImageReadResult
+
+constexpr int DEFAULT_TILE_SIZE = 256;          // Tile edge in pixels
+constexpr size_t DEFAULT_CACHE_TILES = 256;     // Tiles kept in memory (16 MB of 8-bit tiles)
+
+/**
+ * @brief An image stored as square tiles, only a working set of which lives in memory.
+ *
+ * Tiles are kept in an LRU cache of fixed size. When a tile is evicted it is written
+ * to an anonymous scratch file, and read back the next time it is touched, so the
+ * image can be far larger than RAM. Tiles that were never written read as 0.
+ *
+ * Rows are in the same order as ImageReadResult::buffer (the order they are stored
+ * in the BMP file), so a region read from a TiledImage can be fed to any of the
+ * in-memory filters. Access is serialised by an internal mutex.
+ */
+class TiledImage {
+public:
+    TiledImage() = default;
+    TiledImage(const ImageMetadata &meta, int tileSize = DEFAULT_TILE_SIZE,
+               size_t cacheTiles = DEFAULT_CACHE_TILES);
+    ~TiledImage();
+
+    TiledImage(TiledImage &&other) noexcept = default;
+    TiledImage &operator=(TiledImage &&other) noexcept = default;
+    TiledImage(const TiledImage &) = delete;
+    TiledImage &operator=(const TiledImage &) = delete;
+
+    bool isValid() const { return scratch != nullptr; }
+    const ImageMetadata &meta() const { return metadata; }
+    int width() const { return metadata.width; }
+    int height() const { return metadata.height; }
+    int tileSize() const { return tileEdge; }
+
+    // An empty image of the same size, header and color table
+    TiledImage emptyLike() const;
+
+    /**
+     * @brief Copies the region [x, x + w) x [y, y + h) into / out of a packed buffer.
+     *
+     * The buffer holds w * bytesPerPixel bytes per row, h rows. Throws
+     * std::out_of_range if the region is not inside the image.
+     */
+    void readRegion(int x, int y, int w, int h, uint8_t *destination) const;
+    void writeRegion(int x, int y, int w, int h, const uint8_t *source);
+
+    // Same as readRegion, returned as an ImageReadResult of the region size
+    ImageReadResult readRegion(int x, int y, int w, int h) const;
+
+    /**
+     * @brief Streams a BMP file into a tiled image one band of tiles at a time.
+     *
+     * Validates the file the same way readImage does, but without any size limit.
+     * Returns an image with isValid() == false on failure.
+     */
+    static TiledImage fromBmp(const std::string &filePath, int tileSize = DEFAULT_TILE_SIZE,
+                              size_t cacheTiles = DEFAULT_CACHE_TILES);
+
+    // Writes the image as a BMP file, one band of tiles at a time
+    bool writeBmp(const std::string &filePath) const;
+
+    std::vector<uint8_t> header;        // BMP header
+    std::vector<uint8_t> colorTable;    // Color table
+
+private:
+    struct Tile {
+        std::vector<uint8_t> pixels;
+        std::list<int>::iterator lruPosition;
+        bool dirty = false;
+    };
+
+    struct FileCloser {
+        void operator()(std::FILE *file) const { std::fclose(file); }
+    };
+
+    size_t bytesPerPixel() const { return static_cast<size_t>(metadata.bitDepth / 8); }
+    size_t tileBytes() const { return static_cast<size_t>(tileEdge) * tileEdge * bytesPerPixel(); }
+    void checkRegion(int x, int y, int w, int h) const;
+
+    // Both expect the mutex to be held
+    Tile &loadTile(int index) const;
+    void evictTile() const;
+
+    ImageMetadata metadata;
+    int tileEdge = DEFAULT_TILE_SIZE;
+    int tilesAcross = 0;
+    int tilesDown = 0;
+    size_t cacheCapacity = DEFAULT_CACHE_TILES;
+
+    std::unique_ptr<std::FILE, FileCloser> scratch;      // Backing store for evicted tiles
+    std::unique_ptr<std::mutex> mutex = std::make_unique<std::mutex>();
+    mutable std::unordered_map<int, Tile> tiles;         // Tiles currently in memory
+    mutable std::list<int> lru;                           // Most recently used first
+    mutable std::vector<bool> onDisk;                     // Tile has a copy in the scratch file
+};
+
+/**
+ * @brief Runs an in-memory filter over a tiled image tile by tile.
+ *
+ * Each output tile is computed from the input tile grown by `halo` pixels on every
+ * side (clipped to the image), and only the centre is kept. With a halo at least as
+ * large as the filter's reach the result equals running the filter on the whole
+ * image. The filter must return a buffer the size of the region it is given.
+ *
+ * Tiles are filtered in parallel, so the filter must be safe to call from several
+ * threads at once (the in-memory filters are).
+ */
+TiledImage processTiled(const TiledImage &inputImage, int halo,
+                        const std::function<std::vector<uint8_t>(const ImageReadResult &)> &filter);
+
+#endif // TILED_IMAGE_H
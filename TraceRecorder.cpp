@@ -0,0 +1,219 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Per thread, so a long batch run cannot take all the memory (about 64 MiB per thread when full)
+constexpr size_t MAX_EVENTS_PER_THREAD = size_t(1) << 20;
+
+namespace trace_detail {
+std::atomic<bool> recording{false};
+}
+
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    TraceArg first;
+    TraceArg second;
+    int64_t startNanoseconds;
+    int64_t durationNanoseconds;
+};
+
+// Events of one thread; the owning thread appends, the writer reads, both under the (rarely contended) mutex
+struct ThreadTrace {
+    std::mutex mutex;
+    int id = 0;
+    std::string name;
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+};
+
+static std::mutex registryMutex;
+static std::vector<std::shared_ptr<ThreadTrace>> threadTraces;
+static int nextThreadId = 1;
+static std::atomic<int64_t> epochNanoseconds{0};
+
+static thread_local std::shared_ptr<ThreadTrace> localTrace;
+static thread_local TraceSpan *currentSpan = nullptr;
+
+static int64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ThreadTrace &threadTrace() {
+    if (!localTrace) {
+        localTrace = std::make_shared<ThreadTrace>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        localTrace->id = nextThreadId++;
+        threadTraces.push_back(localTrace);
+    }
+    return *localTrace;
+}
+
+void startTraceRecording() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        // Threads that have exited since the last run leave nothing worth keeping
+        threadTraces.erase(std::remove_if(threadTraces.begin(), threadTraces.end(),
+                                          [](const std::shared_ptr<ThreadTrace> &trace) { return trace.use_count() == 1; }),
+                           threadTraces.end());
+        for (const auto &trace : threadTraces) {
+            std::lock_guard<std::mutex> traceLock(trace->mutex);
+            trace->events.clear();
+            trace->dropped = 0;
+        }
+    }
+
+    epochNanoseconds = nowNanoseconds();
+    trace_detail::recording = true;
+}
+
+void stopTraceRecording() {
+    trace_detail::recording = false;
+}
+
+void setTraceThreadName(const std::string &name) {
+    ThreadTrace &trace = threadTrace();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    trace.name = name;
+}
+
+// TraceSpan --------------------------------------------------------------------------------
+
+TraceSpan::TraceSpan(const char *name, const char *category, TraceArg first, TraceArg second)
+    : name(name), category(category), first(first), second(second), active(traceRecording()) {
+    if (!active) {
+        return;
+    }
+
+    outer = currentSpan;
+    currentSpan = this;
+    startNanoseconds = nowNanoseconds();
+}
+
+TraceSpan::~TraceSpan() {
+    if (!active) {
+        return;
+    }
+
+    int64_t endNanoseconds = nowNanoseconds();
+    currentSpan = outer;
+
+    ThreadTrace &trace = threadTrace();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    if (trace.events.size() >= MAX_EVENTS_PER_THREAD) {
+        ++trace.dropped;
+        return;
+    }
+    trace.events.push_back(TraceEvent{name, category, first, second, startNanoseconds, endNanoseconds - startNanoseconds});
+}
+
+const char *currentTraceSpanName(const char *fallback) {
+    return currentSpan ? currentSpan->spanName() : fallback;
+}
+
+// Output -----------------------------------------------------------------------------------
+
+uint64_t traceEventCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t count = 0;
+    for (const auto &trace : threadTraces) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        count += trace->events.size();
+    }
+    return count;
+}
+
+uint64_t droppedTraceEvents() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t dropped = 0;
+    for (const auto &trace : threadTraces) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        dropped += trace->dropped;
+    }
+    return dropped;
+}
+
+static std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void writeTrace(std::ostream &out) {
+    int64_t epoch = epochNanoseconds.load();
+    uint64_t dropped = 0;
+    bool firstEvent = true;
+    char number[64];
+
+    auto beginEvent = [&]() {
+        out << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+    };
+
+    out << "{\"traceEvents\":[";
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto &trace : threadTraces) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        dropped += trace->dropped;
+
+        if (!trace->name.empty()) {
+            beginEvent();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace->id
+                << ",\"args\":{\"name\":" << jsonString(trace->name) << "}}";
+        }
+
+        for (const TraceEvent &event : trace->events) {
+            beginEvent();
+            out << "{\"name\":" << jsonString(event.name) << ",\"cat\":" << jsonString(event.category)
+                << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace->id;
+            std::snprintf(number, sizeof(number), ",\"ts\":%.3f,\"dur\":%.3f", (event.startNanoseconds - epoch) * 1e-3,
+                          event.durationNanoseconds * 1e-3);
+            out << number;
+
+            if (event.first.name || event.second.name) {
+                out << ",\"args\":{";
+                if (event.first.name) {
+                    out << jsonString(event.first.name) << ":" << event.first.value;
+                }
+                if (event.second.name) {
+                    out << (event.first.name ? "," : "") << jsonString(event.second.name) << ":" << event.second.value;
+                }
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+}
+
+void saveTrace(const std::string &path) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open " + path + " for the trace!");
+    }
+    writeTrace(file);
+    if (!file) {
+        throw std::runtime_error("Failed to write the trace to " + path + "!");
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+ * Trace recorder ---------------------------------------------------------------------------
+ *
+ * Records timed spans per thread and writes them as Chrome trace-event JSON, which
+ * chrome://tracing and the Perfetto UI open as a timeline: one track per thread, spans
+ * nested by time. Operations (every ScopedTimer), the stages of multi-pass kernels,
+ * parallelFor chunks and tiles are recorded, so a run shows where each stage spends its
+ * time and which worker a slow chunk or a wait held up.
+ */
+
+// Numeric argument shown with a span in the viewer; `name` must be a string literal
+struct TraceArg {
+    const char *name = nullptr;
+    long long value = 0;
+};
+
+namespace trace_detail {
+extern std::atomic<bool> recording;
+}
+
+// Off by default; while off, a span costs one relaxed load
+inline bool traceRecording() {
+    return trace_detail::recording.load(std::memory_order_relaxed);
+}
+
+// Drops the events recorded so far and starts recording; timestamps count from here
+void startTraceRecording();
+void stopTraceRecording();
+
+// Names the calling thread's track in the timeline (threads without a name show their id)
+void setTraceThreadName(const std::string &name);
+
+/**
+ * @brief Records the enclosing scope as one span on the calling thread's track.
+ *
+ * `name` and `category` must outlive the program (string literals). Spans opened while
+ * recording is off stay inactive even if recording starts before they close.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name, const char *category = "stage", TraceArg first = {}, TraceArg second = {});
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    const char *spanName() const { return name; }
+
+private:
+    const char *name;
+    const char *category;
+    TraceArg first;
+    TraceArg second;
+    bool active;
+    int64_t startNanoseconds = 0;
+    TraceSpan *outer = nullptr;
+};
+
+// Name of the innermost active span on this thread, or `fallback`; parallelFor names its chunks after it
+const char *currentTraceSpanName(const char *fallback);
+
+// Events recorded since the last start, and those dropped because a thread's buffer was full
+uint64_t traceEventCount();
+uint64_t droppedTraceEvents();
+
+// Chrome trace-event JSON ({"traceEvents": [...]}) of everything recorded since the last start
+void writeTrace(std::ostream &out);
+void saveTrace(const std::string &path);
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,502 @@
+#include "UndoHistory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+// Shortest run worth a token of its own; shorter ones stay in the surrounding literal
+constexpr size_t MIN_RUN_LENGTH = 4;
+
+// Run-length coding ------------------------------------------------------------------------
+
+static void putCount(std::vector<uint8_t> &output, size_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+std::vector<uint8_t> encodeRunLength(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> output;
+    size_t literalStart = 0;
+
+    auto flushLiteral = [&](size_t end) {
+        if (end > literalStart) {
+            putCount(output, (end - literalStart) << 1);
+            output.insert(output.end(), data + literalStart, data + end);
+        }
+    };
+
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && data[i + run] == data[i]) {
+            ++run;
+        }
+
+        if (run >= MIN_RUN_LENGTH) {
+            flushLiteral(i);
+            putCount(output, (run << 1) | 1);
+            output.push_back(data[i]);
+            literalStart = i + run;
+        }
+        i += run;
+    }
+    flushLiteral(size);
+
+    return output;
+}
+
+void decodeRunLength(const std::vector<uint8_t>& encoded, uint8_t* output, size_t size) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < encoded.size()) {
+        size_t header = 0;
+        int shift = 0;
+        for (;;) {
+            if (in >= encoded.size() || shift > 56) {
+                throw std::runtime_error("Corrupt run-length data!");
+            }
+            uint8_t byte = encoded[in++];
+            header |= static_cast<size_t>(byte & 0x7f) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+
+        size_t count = header >> 1;
+        if (count > size - out) {
+            throw std::runtime_error("Corrupt run-length data!");
+        }
+
+        if (header & 1) {
+            if (in >= encoded.size()) {
+                throw std::runtime_error("Corrupt run-length data!");
+            }
+            std::fill(output + out, output + out + count, encoded[in++]);
+        } else {
+            if (count > encoded.size() - in) {
+                throw std::runtime_error("Corrupt run-length data!");
+            }
+            std::copy(encoded.begin() + in, encoded.begin() + in + count, output + out);
+            in += count;
+        }
+        out += count;
+    }
+
+    if (out != size) {
+        throw std::runtime_error("Corrupt run-length data!");
+    }
+}
+
+static void xorInto(std::vector<uint8_t> &target, const std::vector<uint8_t> &other) {
+    for (size_t i = 0; i < target.size(); ++i) {
+        target[i] ^= other[i];
+    }
+}
+
+// UndoHistory ------------------------------------------------------------------------------
+
+UndoHistory::UndoHistory(size_t memoryBudget, const std::string &spillDirectory)
+    : budget(memoryBudget), spillDirectory(spillDirectory), encoder(&UndoHistory::encoderMain, this) {}
+
+UndoHistory::~UndoHistory() {
+    clear();
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        stopping = true;
+    }
+    encoderWake.notify_all();
+    encoder.join();
+}
+
+void UndoHistory::push(const ImageReadResult &image, const PointOpChain &pointOps) {
+    clearStack(redoStack);
+    pushState(undoStack, image, pointOps);
+    enforceBudget();
+}
+
+bool UndoHistory::undo(ImageReadResult &image, PointOpChain &pointOps) {
+    if (!canUndo()) {
+        return false;
+    }
+
+    pushState(redoStack, image, pointOps);
+    popState(undoStack, image, pointOps);
+    enforceBudget();
+    return true;
+}
+
+bool UndoHistory::redo(ImageReadResult &image, PointOpChain &pointOps) {
+    if (!canRedo()) {
+        return false;
+    }
+
+    pushState(undoStack, image, pointOps);
+    popState(redoStack, image, pointOps);
+    enforceBudget();
+    return true;
+}
+
+void UndoHistory::clear() {
+    clearStack(undoStack);
+    clearStack(redoStack);
+}
+
+void UndoHistory::finishEncoding() {
+    for (Stack *stack : {&undoStack, &redoStack}) {
+        for (Entry &entry : stack->entries) {
+            collectEncoding(entry, true);
+        }
+    }
+    enforceBudget();
+}
+
+void UndoHistory::setMemoryBudget(size_t bytes) {
+    budget = bytes;
+    enforceBudget();
+}
+
+void UndoHistory::setSpillDirectory(const std::string &directory) {
+    spillDirectory = directory;
+    enforceBudget();
+}
+
+void UndoHistory::setSpillBudget(size_t bytes) {
+    diskBudget = bytes;
+    enforceBudget();
+}
+
+size_t UndoHistory::memoryUsage() const {
+    size_t total = 0;
+    for (const Stack *stack : {&undoStack, &redoStack}) {
+        for (const Entry &entry : stack->entries) {
+            total += entry.encoded.size() + entry.header.size() + entry.colorTable.size() + sizeof(Entry);
+        }
+        if (stack->top.has_value()) {
+            total += stack->top->size();
+        }
+    }
+    return total;
+}
+
+size_t UndoHistory::spilledBytes() const {
+    size_t total = 0;
+    for (const Stack *stack : {&undoStack, &redoStack}) {
+        for (const Entry &entry : stack->entries) {
+            if (!entry.spillPath.empty()) {
+                total += entry.encodedSize;
+            }
+        }
+    }
+    return total;
+}
+
+void UndoHistory::pushState(Stack &stack, const ImageReadResult &image, const PointOpChain &pointOps) {
+    Entry entry;
+    entry.meta = image.meta;
+    entry.header = image.header;
+    entry.colorTable = image.colorTable;
+    entry.pointOps = pointOps;
+    entry.hasPixels = image.buffer.has_value();
+
+    if (entry.hasPixels) {
+        const PixelBuffer &top = stack.top;     // Read only, so sharing it with the image is kept
+        entry.pixelCount = image.buffer->size();
+
+        if (image.buffer.sharesWith(top)) {
+            // Same pixels as the state below (only the point operations changed): an all-zero diff
+            if (entry.pixelCount > 0) {
+                putCount(entry.encoded, (entry.pixelCount << 1) | 1);
+                entry.encoded.push_back(0);
+            }
+            entry.keyframe = false;
+        } else if (top.has_value() && top->size() == entry.pixelCount) {
+            entry.keyframe = false;
+            startEncoding(entry, image.buffer, top);
+        } else {
+            startEncoding(entry, image.buffer, PixelBuffer());
+        }
+    }
+    entry.encodedSize = entry.encoded.size();
+
+    stack.entries.push_back(std::move(entry));
+    stack.top = image.buffer;   // Shared with the image until one of them is written
+}
+
+void UndoHistory::popState(Stack &stack, ImageReadResult &image, PointOpChain &pointOps) {
+    Entry &entry = stack.entries.back();
+
+    image.meta = entry.meta;
+    image.header = entry.header;
+    image.colorTable = entry.colorTable;
+    image.buffer = stack.top;
+    pointOps = entry.pointOps;
+
+    // Decode the state below, which becomes the new top
+    PixelBuffer below;
+    if (stack.entries.size() > 1) {
+        const Entry &next = stack.entries[stack.entries.size() - 2];
+        if (!entry.keyframe && next.hasPixels) {
+            // A state still waiting to be coded holds the pixels below it
+            if (entry.pending) {
+                std::lock_guard<std::mutex> lock(encoderMutex);
+                if (!entry.pending->done) {
+                    below = entry.pending->below;
+                }
+            }
+            if (!below.has_value()) {
+                std::vector<uint8_t> pixels = *std::as_const(stack.top);
+                xorInto(pixels, decodePixels(entry));
+                below = std::move(pixels);
+            }
+        } else if (next.hasPixels) {
+            below = decodeState(stack, stack.entries.size() - 2);
+        }
+    }
+
+    removeSpillFile(entry);
+    cancelEncoding(entry);
+    stack.entries.pop_back();
+    stack.top = below;
+}
+
+void UndoHistory::clearStack(Stack &stack) {
+    for (Entry &entry : stack.entries) {
+        removeSpillFile(entry);
+        cancelEncoding(entry);
+    }
+    stack.entries.clear();
+    stack.top.reset();
+}
+
+// Encoder thread ---------------------------------------------------------------------------
+
+void UndoHistory::startEncoding(Entry &entry, const PixelBuffer &pixels, const PixelBuffer &below) {
+    auto encoding = std::make_shared<Encoding>();
+    encoding->pixels = pixels;
+    encoding->below = below;
+    entry.pending = encoding;
+
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        encoderQueue.push_back(std::move(encoding));
+    }
+    encoderWake.notify_one();
+}
+
+// Moves the coded pixels into the entry once they are done, waiting for them if `wait` is set
+void UndoHistory::collectEncoding(Entry &entry, bool wait) {
+    if (!entry.pending) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(encoderMutex);
+    if (!entry.pending->done) {
+        if (!wait) {
+            return;
+        }
+        encodingDone.wait(lock, [&] { return entry.pending->done; });
+    }
+    std::shared_ptr<Encoding> encoding = std::move(entry.pending);
+    lock.unlock();
+
+    if (encoding->error) {
+        std::rethrow_exception(encoding->error);
+    }
+    entry.encoded = std::move(encoding->encoded);
+    entry.encodedSize = entry.encoded.size();
+}
+
+void UndoHistory::collectEncodings() {
+    for (Stack *stack : {&undoStack, &redoStack}) {
+        for (Entry &entry : stack->entries) {
+            collectEncoding(entry, false);
+        }
+    }
+}
+
+void UndoHistory::cancelEncoding(Entry &entry) {
+    if (entry.pending) {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        entry.pending->cancelled = true;
+    }
+    entry.pending.reset();
+}
+
+void UndoHistory::encoderMain() {
+    std::unique_lock<std::mutex> lock(encoderMutex);
+    for (;;) {
+        encoderWake.wait(lock, [&] { return stopping || !encoderQueue.empty(); });
+        if (stopping) {
+            return;
+        }
+
+        std::shared_ptr<Encoding> encoding = std::move(encoderQueue.front());
+        encoderQueue.pop_front();
+        if (encoding->cancelled) {
+            continue;
+        }
+
+        // Own references, so popState may copy `below` out of the job meanwhile
+        PixelBuffer pixels = encoding->pixels;
+        PixelBuffer below = encoding->below;
+        lock.unlock();
+
+        std::vector<uint8_t> encoded;
+        std::exception_ptr error;
+        try {
+            if (below.has_value()) {
+                std::vector<uint8_t> diff = *std::as_const(pixels);
+                xorInto(diff, *std::as_const(below));
+                encoded = encodeRunLength(diff.data(), diff.size());
+            } else {
+                const std::vector<uint8_t> &current = *std::as_const(pixels);
+                encoded = encodeRunLength(current.data(), current.size());
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        pixels.reset();
+        below.reset();
+
+        lock.lock();
+        encoding->encoded = std::move(encoded);
+        encoding->error = error;
+        encoding->pixels.reset();
+        encoding->below.reset();
+        encoding->done = true;
+        encodingDone.notify_all();
+    }
+}
+
+// Coded states -----------------------------------------------------------------------------
+
+std::vector<uint8_t> UndoHistory::loadEncoded(const Entry &entry) const {
+    if (entry.pending) {
+        std::unique_lock<std::mutex> lock(encoderMutex);
+        encodingDone.wait(lock, [&] { return entry.pending->done; });
+        if (entry.pending->error) {
+            std::rethrow_exception(entry.pending->error);
+        }
+        return entry.pending->encoded;
+    }
+    if (entry.spillPath.empty()) {
+        return entry.encoded;
+    }
+
+    std::ifstream file(entry.spillPath, std::ios::binary);
+    std::vector<uint8_t> encoded(entry.encodedSize);
+    if (!file.read(reinterpret_cast<char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()))) {
+        throw std::runtime_error("Failed to read undo state from " + entry.spillPath + "!");
+    }
+    return encoded;
+}
+
+// The entry's own coded bytes: its pixels for a keyframe, its XOR with the entry below otherwise
+std::vector<uint8_t> UndoHistory::decodePixels(const Entry &entry) const {
+    std::vector<uint8_t> pixels(entry.pixelCount);
+    decodeRunLength(loadEncoded(entry), pixels.data(), pixels.size());
+    return pixels;
+}
+
+// Full pixels of entries[index]: the nearest keyframe at or below it, then the deltas up to it
+std::vector<uint8_t> UndoHistory::decodeState(const Stack &stack, size_t index) const {
+    size_t first = index;
+    while (!stack.entries[first].keyframe) {
+        --first;
+    }
+
+    std::vector<uint8_t> pixels = decodePixels(stack.entries[first]);
+    for (size_t i = first + 1; i <= index; ++i) {
+        xorInto(pixels, decodePixels(stack.entries[i]));
+    }
+    return pixels;
+}
+
+// Forgets the oldest state of a stack; the one above it is recoded as a keyframe
+void UndoHistory::dropBottom(Stack &stack) {
+    if (stack.entries.size() > 1 && !stack.entries[1].keyframe) {
+        Entry &second = stack.entries[1];
+        std::vector<uint8_t> pixels = decodeState(stack, 1);
+
+        removeSpillFile(second);
+        cancelEncoding(second);
+        second.encoded = encodeRunLength(pixels.data(), pixels.size());
+        second.encodedSize = second.encoded.size();
+        second.keyframe = true;
+    }
+
+    removeSpillFile(stack.entries.front());
+    cancelEncoding(stack.entries.front());
+    stack.entries.pop_front();
+    if (stack.entries.empty()) {
+        stack.top.reset();
+    }
+}
+
+// Moves the oldest coded state still in memory to a file; false if there is none
+bool UndoHistory::spillOldest(Stack &stack) {
+    for (Entry &entry : stack.entries) {
+        if (!entry.spillPath.empty() || entry.encoded.empty()) {
+            continue;
+        }
+
+        std::string path = spillDirectory + "/undo-" + std::to_string(reinterpret_cast<uintptr_t>(this)) + "-" +
+                           std::to_string(nextSpillId++) + ".bin";
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char *>(entry.encoded.data()),
+                        static_cast<std::streamsize>(entry.encoded.size()))) {
+            throw std::runtime_error("Failed to write undo state to " + path + "!");
+        }
+
+        entry.spillPath = path;
+        entry.encoded.clear();
+        entry.encoded.shrink_to_fit();
+        return true;
+    }
+    return false;
+}
+
+void UndoHistory::removeSpillFile(Entry &entry) {
+    if (!entry.spillPath.empty()) {
+        std::remove(entry.spillPath.c_str());
+        entry.spillPath.clear();
+    }
+}
+
+// Oldest undo states first, then the redo states furthest ahead; the newest undo state stays
+bool UndoHistory::dropOldest() {
+    if (undoStack.entries.size() > 1) {
+        dropBottom(undoStack);
+    } else if (!redoStack.entries.empty()) {
+        dropBottom(redoStack);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void UndoHistory::enforceBudget() {
+    collectEncodings();
+
+    for (;;) {
+        bool overMemory = memoryUsage() > budget;
+        if (overMemory && !spillDirectory.empty()) {
+            if (spillOldest(undoStack) || spillOldest(redoStack)) {
+                continue;
+            }
+            // What is left in memory is mostly the decoded tops, which dropping states would not free
+            overMemory = false;
+        }
+
+        if ((!overMemory && spilledBytes() <= diskBudget) || !dropOldest()) {
+            return;
+        }
+    }
+}
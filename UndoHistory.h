@@ -0,0 +1,158 @@
+#ifndef UNDO_HISTORY_H
+#define UNDO_HISTORY_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageIO.h"
+#include "imageprocessingbackend.h"     // PointOpChain
+
+// Memory the history may use before it spills or drops old states
+constexpr size_t DEFAULT_UNDO_MEMORY_BUDGET = size_t(256) << 20;
+
+// Bytes of spill files the history may leave on disk before it drops old states
+constexpr size_t DEFAULT_UNDO_SPILL_BUDGET = size_t(2) << 30;
+
+/**
+ * @brief Byte-oriented run-length coding.
+ *
+ * The stream is a sequence of tokens, each a varint header h followed by data: when h is odd,
+ * one byte repeated h >> 1 times; when h is even, h >> 1 literal bytes. Long runs of one value
+ * (the zeros of an XOR diff, the 0/255 areas of a thresholded image) shrink to two or three bytes.
+ */
+std::vector<uint8_t> encodeRunLength(const uint8_t* data, size_t size);
+
+// Decodes exactly `size` bytes into output; throws std::runtime_error if the stream does not hold them
+void decodeRunLength(const std::vector<uint8_t>& encoded, uint8_t* output, size_t size);
+
+/**
+ * @brief Unbounded undo/redo history of images and their pending point operations.
+ *
+ * States are kept on two stacks. On each stack the oldest state, and any state whose size
+ * differs from the one below it, is a keyframe: its pixels are run-length coded on their own.
+ * Every other state is stored as the run-length coded XOR of its pixels with those of the state
+ * below it, which is tiny when an operation only changes part of the image and for binary and
+ * thresholded results. The pixels of each stack's top state are also kept decoded (shared
+ * copy-on-write with the image they came from), so an undo or redo decodes one delta.
+ *
+ * The coding runs on a thread of the history's own, so recording a state costs the caller a
+ * reference count; a state is only waited for when it is needed before its coding is done
+ * (undoing straight back past it, say). States still being coded are left out of the memory
+ * usage until the next push, undo or redo finds them done.
+ *
+ * When the coded states take more than the memory budget, the oldest ones are written to files
+ * in the spill directory, or dropped if there is none. Once the spill files take more than the
+ * spill budget the oldest states are dropped too. The newest undo state is always kept.
+ */
+class UndoHistory {
+public:
+    explicit UndoHistory(size_t memoryBudget = DEFAULT_UNDO_MEMORY_BUDGET,
+                         const std::string &spillDirectory = std::string());
+    ~UndoHistory();
+
+    UndoHistory(const UndoHistory &) = delete;
+    UndoHistory &operator=(const UndoHistory &) = delete;
+
+    // Records a state to return to before it is changed; clears the redo states
+    void push(const ImageReadResult &image, const PointOpChain &pointOps);
+
+    // Replace the current state with the previous (next) one, saving the current one for redo
+    // (undo). Return false, leaving everything as it was, when there is nothing to go back to.
+    bool undo(ImageReadResult &image, PointOpChain &pointOps);
+    bool redo(ImageReadResult &image, PointOpChain &pointOps);
+
+    void clear();
+
+    // Waits until every recorded state is coded, then applies the budgets to all of them
+    void finishEncoding();
+
+    bool canUndo() const { return !undoStack.entries.empty(); }
+    bool canRedo() const { return !redoStack.entries.empty(); }
+    size_t undoCount() const { return undoStack.entries.size(); }
+    size_t redoCount() const { return redoStack.entries.size(); }
+
+    // An empty directory means old states are dropped instead of spilled
+    void setMemoryBudget(size_t bytes);
+    void setSpillDirectory(const std::string &directory);
+    void setSpillBudget(size_t bytes);
+    size_t memoryBudget() const { return budget; }
+    size_t spillBudget() const { return diskBudget; }
+
+    // Bytes held in memory (coded states and decoded stack tops) and in spill files
+    size_t memoryUsage() const;
+    size_t spilledBytes() const;
+
+private:
+    // Coding of one state, done on the encoder thread
+    struct Encoding {
+        PixelBuffer pixels;
+        PixelBuffer below;              // Pixels of the state below for a delta, empty for a keyframe
+        std::vector<uint8_t> encoded;
+        std::exception_ptr error;       // What coding threw (out of memory), rethrown where the bytes are needed
+        bool done = false;
+        bool cancelled = false;         // The state was popped or dropped before its turn came
+    };
+
+    struct Entry {
+        ImageMetadata meta;
+        std::vector<uint8_t> header;
+        std::vector<uint8_t> colorTable;
+        PointOpChain pointOps;
+
+        bool hasPixels = false;
+        bool keyframe = true;           // Coded on its own rather than against the entry below
+        size_t pixelCount = 0;
+        std::vector<uint8_t> encoded;   // Run-length coded pixels or XOR diff; empty while spilled
+        size_t encodedSize = 0;
+        std::string spillPath;          // File holding the coded pixels once spilled
+        std::shared_ptr<Encoding> pending;  // Set until the coded pixels have been collected into `encoded`
+    };
+
+    struct Stack {
+        std::deque<Entry> entries;      // The back is the top
+        PixelBuffer top;                // Decoded pixels of entries.back()
+    };
+
+    void pushState(Stack &stack, const ImageReadResult &image, const PointOpChain &pointOps);
+    void popState(Stack &stack, ImageReadResult &image, PointOpChain &pointOps);
+    void clearStack(Stack &stack);
+
+    void startEncoding(Entry &entry, const PixelBuffer &pixels, const PixelBuffer &below);
+    void collectEncoding(Entry &entry, bool wait);
+    void collectEncodings();
+    void cancelEncoding(Entry &entry);
+    void encoderMain();
+
+    std::vector<uint8_t> loadEncoded(const Entry &entry) const;
+    std::vector<uint8_t> decodePixels(const Entry &entry) const;
+    std::vector<uint8_t> decodeState(const Stack &stack, size_t index) const;
+    void dropBottom(Stack &stack);
+    bool spillOldest(Stack &stack);
+    void removeSpillFile(Entry &entry);
+    bool dropOldest();
+    void enforceBudget();
+
+    Stack undoStack;
+    Stack redoStack;
+    size_t budget;
+    size_t diskBudget = DEFAULT_UNDO_SPILL_BUDGET;
+    std::string spillDirectory;
+    uint64_t nextSpillId = 0;
+
+    mutable std::mutex encoderMutex;            // Guards the queue and the Encoding objects' flags and results
+    std::condition_variable encoderWake;
+    mutable std::condition_variable encodingDone;
+    std::deque<std::shared_ptr<Encoding>> encoderQueue;
+    bool stopping = false;
+    std::thread encoder;                        // Last, so it starts once everything above is set up
+};
+
+#endif // UNDO_HISTORY_H
@@ -0,0 +1,62 @@
+#include "displaycache.h"
+#include "ImagePyramid.h"
+
+QPixmap DisplayCache::render(const ImageReadResult &image, const QSize &size, const PointOpChain &pointOps)
+{
+    if (!image.buffer.has_value() || !image.meta.isValid() || size.isEmpty()) {
+        return QPixmap();
+    }
+
+    if (!isCurrent(image, size)) {
+        int width = image.meta.width;
+        int height = image.meta.height;
+
+        // Qt's smooth scaler converts a grayscale image to RGB32 first, which on the full image
+        // would be a copy four times its size. Halve it in grayscale while it is at least twice
+        // the label, so the scaler only sees an image up to twice the label's size
+        ImageView rowsView{image.buffer->data(), width, height, width};
+        ImageBuffer halved;
+        while (rowsView.width >= 2 * size.width() || rowsView.height >= 2 * size.height()) {
+            halved = downsampleImage(rowsView);
+            rowsView = halved.view();
+        }
+
+        // Wrap the bottom-up rows without copying, scale them to the label, bring the result back
+        // to one byte per pixel for the point operations and flip it
+        QImage rows(rowsView.data, rowsView.width, rowsView.height, rowsView.width, QImage::Format_Grayscale8);
+        scaled = rows.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                     .convertToFormat(QImage::Format_Grayscale8)
+                     .mirrored(false, true);
+
+        source = image.buffer;
+        sourceWidth = width;
+        sourceHeight = height;
+        targetSize = size;
+    }
+
+    if (pointOps.isEmpty()) {
+        return QPixmap::fromImage(scaled);
+    }
+
+    // Point operations go on the few cached pixels rather than the full image. Applying them after
+    // the smoothing instead of before only shifts grey levels along edges, which is fine on screen
+    Q_ASSERT(scaled.format() == QImage::Format_Grayscale8);
+    QImage shown(scaled.size(), QImage::Format_Grayscale8);
+    for (int r = 0; r < scaled.height(); ++r) {
+        applyLut(scaled.constScanLine(r), shown.scanLine(r), scaled.width(), pointOps.lut());
+    }
+    return QPixmap::fromImage(shown);
+}
+
+void DisplayCache::clear()
+{
+    source.reset();
+    scaled = QImage();
+    targetSize = QSize();
+}
+
+bool DisplayCache::isCurrent(const ImageReadResult &image, const QSize &size) const
+{
+    return image.buffer.sharesWith(source) && image.meta.width == sourceWidth &&
+           image.meta.height == sourceHeight && size == targetSize;
+}
@@ -0,0 +1,41 @@
+#ifndef DISPLAYCACHE_H
+#define DISPLAYCACHE_H
+
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+
+#include "ImageIO.h"
+#include "imageprocessingbackend.h"
+
+/**
+ * @brief Keeps an image flipped and scaled to the label showing it, so redraws cost screen pixels.
+ *
+ * The BMP rows are stored bottom-up. The first render of an image at a given label size
+ * halves the rows in grayscale down to at most twice the label, scales that to the label
+ * and flips the result; no full-size QImage copy is made. Later renders of the same pixels at
+ * the same size only apply the pending point operations to that cached image, so dragging
+ * a gamma or threshold slider does work proportional to the label, not to the image.
+ *
+ * The cache holds a shared reference to the pixels it was built from; any write to the
+ * image unshares them (see PixelBuffer), which is how a change is detected.
+ */
+class DisplayCache
+{
+public:
+    // The image fitted into `size` (aspect ratio kept) with `pointOps` applied to what is shown
+    QPixmap render(const ImageReadResult &image, const QSize &size, const PointOpChain &pointOps = PointOpChain());
+
+    void clear();
+
+private:
+    bool isCurrent(const ImageReadResult &image, const QSize &size) const;
+
+    PixelBuffer source;         // Pixels `scaled` was built from
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    QSize targetSize;
+    QImage scaled;              // Grayscale8, top-down, fitted into targetSize, point operations not applied
+};
+
+#endif // DISPLAYCACHE_H
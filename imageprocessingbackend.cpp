@@ -1,4 +1,4 @@
-#include "imageProcessingBackend.h"
+#include "imageprocessingbackend.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -10,6 +10,8 @@
 #include "ImageMorphology.h"
 #include "ImageUtils.h"
 #include "ImageEdgeDetection.h"
+#include "ProcessingControl.h"
+#include "Instrumentation.h"
 
 // Function to load an image from a file
 #include <algorithm> // For std::reverse
@@ -19,8 +21,13 @@ void saveImage(const char *filePath, const ImageReadResult *image) {
 
 }
 
+static uint64_t pixelCount(const ImageReadResult &image) {
+    return static_cast<uint64_t>(std::max(image.meta.width, 0)) * std::max(image.meta.height, 0);
+}
+
 // Function to apply a negative transformation
 void applyNegativeB(ImageReadResult *image) {
+    ScopedTimer timer("Negative", pixelCount(*image));
     applyNegative(image->buffer->data(), image->meta);
 }
 
@@ -28,15 +35,73 @@ void applyNegativeB(ImageReadResult *image) {
 
 // Function to apply a logarithmic transformation
 void applyLogTransform(ImageReadResult *image, double c) {
+    ScopedTimer timer("Log transform", pixelCount(*image));
     applyLogTransform(image->buffer->data(), image->meta, c);
 }
 
 
 // Function to apply a gamma transformation
 void applyGammaTransform(ImageReadResult *image, double c, double gamma) {
+    ScopedTimer timer("Gamma transform", pixelCount(*image));
     applyGammaTransform(image->buffer->data(), image->meta, c, gamma);
 }
 
+// Deferred point operations
+
+void PointOpChain::append(const IntensityLut &lut) {
+    composed = composeLuts(composed, lut);
+    ++length;
+}
+
+void PointOpChain::clear() {
+    composed = makeIdentityLut();
+    length = 0;
+}
+
+void PointOpChain::materialize(ImageReadResult &image) {
+    if (isEmpty()) {
+        return;
+    }
+    if (!image.buffer.has_value() || !image.meta.isValid()) {
+        throw std::invalid_argument("Invalid input image!");
+    }
+
+    ScopedTimer timer("Point operations", pixelCount(image));
+
+    // Same pixel count as the immediate transforms
+    size_t pixels = static_cast<size_t>(image.meta.width) * image.meta.height;
+    applyLut(image.buffer->data(), image.buffer->data(), pixels, composed);
+    clear();
+}
+
+void deferNegative(PointOpChain &chain, const ImageMetadata &meta) {
+    chain.append(makeNegativeLut(meta.bitDepth));
+}
+
+void deferLogTransform(PointOpChain &chain, const ImageMetadata &meta, double c) {
+    chain.append(makeLogLut(meta.bitDepth, c));
+}
+
+void deferGammaTransform(PointOpChain &chain, const ImageMetadata &meta, double c, double gamma) {
+    chain.append(makeGammaLut(meta.bitDepth, c, gamma));
+}
+
+void deferGrayscaleToBinary(PointOpChain &chain, int threshold) {
+    chain.append(makeThresholdLut(threshold));
+}
+
+// Gives outputImage the header, color table and metadata of inputImage and the new pixels.
+// Assigning the whole input first would copy its pixel buffer only to throw it away.
+static void setResult(const ImageReadResult &inputImage, ImageReadResult &outputImage, std::vector<uint8_t> &&pixels) {
+    if (&outputImage != &inputImage) {
+        outputImage.header = inputImage.header;
+        outputImage.colorTable = inputImage.colorTable;
+        outputImage.meta = inputImage.meta;
+    }
+    countAllocation(pixels.size());
+    outputImage.buffer = std::move(pixels);
+}
+
 // Function to apply a box filter
 
 void boxFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize) {
@@ -44,24 +109,34 @@ void boxFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage,
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("Box filter", pixelCount(inputImage));
+
     try {
         auto filteredBuffer = applyBoxFilter(inputImage, kernelSize);
-        outputImage = inputImage; // Copy metadata and other details
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw; // Not a failure, let the caller see it was cancelled
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Box Filter failed: ") + e.what());
     }
 }
 
-void gaussianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize, double sigma) {
+void gaussianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize, double sigma,
+                    GaussianMode mode) {
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("Gaussian filter", pixelCount(inputImage));
+
     try {
-        auto filteredBuffer = applyGaussianFilter(inputImage, kernelSize, sigma);
-        outputImage = inputImage; // Copy metadata and other details
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        // The recursive mode ignores the kernel size: its cost and support depend only on sigma
+        auto filteredBuffer = (mode == GaussianMode::RECURSIVE)
+                                  ? applyRecursiveGaussianFilter(inputImage, sigma)
+                                  : applyGaussianFilter(inputImage, kernelSize, sigma);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Gaussian Filter failed: ") + e.what());
     }
@@ -73,10 +148,13 @@ void medianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImag
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("Median filter", pixelCount(inputImage));
+
     try {
         auto filteredBuffer = applyMedianFilter(inputImage, kernelSize);
-        outputImage = inputImage; // Copy metadata and other details
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Median Filter failed: ") + e.what());
     }
@@ -88,10 +166,13 @@ void highpassFilter(const ImageReadResult &inputImage, ImageReadResult &outputIm
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("High-pass filter", pixelCount(inputImage));
+
     try {
         auto filteredBuffer = applyHighPassFilter(inputImage, kernelChoice);
-        outputImage = inputImage; // copy the metadata
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Highpass Filter failed: ") + e.what());
     }
@@ -102,10 +183,13 @@ void imageSharpening(const ImageReadResult &inputImage, ImageReadResult &outputI
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("Sharpening", pixelCount(inputImage));
+
     try {
         auto filteredBuffer = applyImageSharpening(inputImage, kernelChoice);
-        outputImage = inputImage; // copy the metadata
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image sharpening failed: ") + e.what());
     }
@@ -116,10 +200,13 @@ void umhbf(const ImageReadResult &inputImage, ImageReadResult &outputImage, doub
         throw std::invalid_argument("Invalid input image!");
     }
 
+    ScopedTimer timer("Unsharp masking", pixelCount(inputImage));
+
     try {
         auto filteredBuffer = applyUMHBF(inputImage, k);
-        outputImage = inputImage; // copy the metadata
-        outputImage.buffer = std::make_optional(filteredBuffer);
+        setResult(inputImage, outputImage, std::move(filteredBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Unsharp masking and highboost filtering failed: ") + e.what());
     }
@@ -129,10 +216,13 @@ void grayscaleToBinary(const ImageReadResult &inputImage, ImageReadResult &outpu
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Grayscale to binary", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyGrayscaleToBinary(inputImage, threshold);
-        outputImage = inputImage; // copy the metadata
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image conversion failed: ") + e.what());
     }
@@ -144,10 +234,13 @@ void erosion(const ImageReadResult &inputImage, ImageReadResult &outputImage, in
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Erosion", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyErosion(inputImage, kernelCols, kernelRows);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image erosion failed: ") + e.what());
     }
@@ -157,10 +250,13 @@ void dilation(const ImageReadResult &inputImage, ImageReadResult &outputImage, i
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Dilation", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyDilation(inputImage, kernelCols, kernelRows);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image dilation failed: ") + e.what());
     }
@@ -170,10 +266,13 @@ void opening(const ImageReadResult &inputImage, ImageReadResult &outputImage, in
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Opening", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyOpening(inputImage, kernelCols, kernelRows);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image opening failed: ") + e.what());
     }
@@ -183,10 +282,13 @@ void closing(const ImageReadResult &inputImage, ImageReadResult &outputImage, in
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Closing", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyClosing(inputImage, kernelCols, kernelRows);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Image closing failed: ") + e.what());
     }
@@ -196,10 +298,13 @@ void boundaryExtraction(const ImageReadResult &inputImage, ImageReadResult &outp
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Boundary extraction", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyBoundaryExtraction(inputImage, kernelCols, kernelRows);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Boundary extraction failed: ") + e.what());
     }
@@ -216,10 +321,13 @@ void gradientEdgeDetection(const ImageReadResult &inputImage, ImageReadResult &o
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Gradient edge detection", pixelCount(inputImage));
     try {
         auto convertedBuffer = applyGradientEdgeDetection(inputImage, kernelChoice, applyThreshold, thresholdValue, paddingChoice);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
         throw std::runtime_error(std::string("Boundary extraction failed: ") + e.what());
     }
@@ -235,12 +343,15 @@ void cannyEdgeDetection(const ImageReadResult &inputImage, ImageReadResult &outp
     if (!inputImage.buffer.has_value() || !inputImage.meta.isValid()) {
         throw std::invalid_argument("Invalid input image!");
     }
+
+    ScopedTimer timer("Canny edge detection", pixelCount(inputImage));
     try {
-        auto convertedBuffer = applyCannyEdgeDetection(inputImage, lowthreshold, highThreshold, kernelSize, sigma, paddingChoice);
-        outputImage = inputImage;
-        outputImage.buffer = std::make_optional(convertedBuffer);
+        auto convertedBuffer = applyCannyEdgeDetection(inputImage, lowthreshold, highThreshold, sigma, kernelSize, paddingChoice);
+        setResult(inputImage, outputImage, std::move(convertedBuffer));
+    } catch (const OperationCancelled &) {
+        throw;
     } catch (const std::exception &e) {
-        throw std::runtime_error(std::string("Boundary extraction failed: ") + e.what());
+        throw std::runtime_error(std::string("Canny edge detection failed: ") + e.what());
     }
 }
 
@@ -5,6 +5,7 @@
 
 #include "ImageIO.h"
 #include "ImageUtils.h"
+#include "IntensityTransformations.h"
 
 
 typedef struct {
@@ -20,8 +21,43 @@ void applyNegativeB(ImageReadResult *image);
 void applyLogTransform(ImageReadResult *image, double c);
 void applyGammaTransform(ImageReadResult *image, double c, double gamma);
 
+// Deferred point operations -----------------------------------------------------------------------------
+
+/**
+ * @brief A chain of 8-bit point operations that has not been applied to the pixels yet.
+ *
+ * Every operation appended is composed into one lookup table straight away, so however
+ * long the chain gets, applying it costs a single pass over the image. The chain is
+ * applied with materialize() when an operation needs the real pixels, or on the fly
+ * by the display.
+ */
+class PointOpChain {
+public:
+    // Adds an operation that runs after the ones already in the chain
+    void append(const IntensityLut &lut);
+    void clear();
+
+    bool isEmpty() const { return length == 0; }
+    size_t size() const { return length; }
+    const IntensityLut &lut() const { return composed; }
+
+    // Applies the chain to the image's pixels in one pass and empties it
+    void materialize(ImageReadResult &image);
+
+private:
+    IntensityLut composed = makeIdentityLut();
+    size_t length = 0;
+};
+
+// Same operations as above, added to a chain instead of applied to the image
+void deferNegative(PointOpChain &chain, const ImageMetadata &meta);
+void deferLogTransform(PointOpChain &chain, const ImageMetadata &meta, double c);
+void deferGammaTransform(PointOpChain &chain, const ImageMetadata &meta, double c, double gamma);
+void deferGrayscaleToBinary(PointOpChain &chain, int threshold);
+
 void boxFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize);
-void gaussianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize, double sigma);
+void gaussianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize, double sigma,
+                    GaussianMode mode = GaussianMode::SEPARABLE);
 void medianFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelSize);
 
 void highpassFilter(const ImageReadResult &inputImage, ImageReadResult &outputImage, int kernelChoice);
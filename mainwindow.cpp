@@ -3,12 +3,19 @@
 #include <QMessageBox> // For QMessageBox
 #include <QImage>      // For QImage
 #include <QPixmap>     // For displaying images in QLabel
+#include <QStatusBar>  // For job progress messages
+#include <QTimer>      // For settling previews
+#include <QStringList> // For reporting discarded operations
 #include <cstring>     // For std::memcpy (used in helper functions)
+#include <algorithm>   // For std::max_element
+#include <sstream>     // For the instrumentation tooltip
 #include <QDebug>
 
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "imageprocessingbackend.h"
+#include "ImagePyramid.h"
+#include "Instrumentation.h"
 
 // }
 
@@ -31,6 +38,70 @@ MainWindow::MainWindow(QWidget *parent)
 
     switchToPage(0);
 
+    // States beyond the memory budget are spilled instead of dropped, up to the history's spill budget
+    if (undoSpillDirectory.isValid()) {
+        history.setSpillDirectory(undoSpillDirectory.path().toStdString());
+    }
+
+    setInstrumentationEnabled(true);
+    statsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(statsLabel);
+
+    worker = new ProcessingWorker(this);
+    connect(worker, &ProcessingWorker::jobStarted, this, [this](quint64, const QString &name) {
+        activeJobName = name;
+        statusBar()->showMessage(tr("%1...").arg(name));
+    });
+    connect(worker, &ProcessingWorker::progressChanged, this, [this](quint64, int percent) {
+        statusBar()->showMessage(tr("%1: %2%").arg(activeJobName).arg(percent));
+    });
+    connect(worker, &ProcessingWorker::jobFinished, this, [this](quint64, const ImageReadResult &result) {
+        history.push(jobSnapshot, jobSnapshotPointOps);
+        jobSnapshot = ImageReadResult();
+        jobSnapshotPointOps.clear();
+
+        resultImage = result;
+        updateResultDisplay();
+        statusBar()->showMessage(tr("%1 completed").arg(activeJobName), 3000);
+        updateStatsLabel();
+        qDebug() << activeJobName << "completed";
+
+        runQueuedOperations();
+    });
+    connect(worker, &ProcessingWorker::jobFailed, this, [this](quint64, const QString &message) {
+        // Back to the state before the job; the operations queued behind it assumed it would succeed
+        resultImage = jobSnapshot;
+        resultPointOps = jobSnapshotPointOps;
+        jobSnapshot = ImageReadResult();
+        jobSnapshotPointOps.clear();
+
+        statusBar()->clearMessage();
+        discardQueuedOperations(tr("%1 failed").arg(activeJobName));
+        QMessageBox::critical(this, tr("Error"), tr("%1 failed: %2").arg(activeJobName, message));
+    });
+
+    // Previews run on a worker of their own, so a preview never cancels a real job; each new
+    // preview supersedes the one in flight, so only the latest control value gets drawn
+    previewWorker = new ProcessingWorker(this);
+    connect(previewWorker, &ProcessingWorker::jobFinished, this, [this](quint64, const ImageReadResult &result) {
+        ui->ResultWindowLabel->setPixmap(previewDisplay.render(result, ui->ResultWindowLabel->size()));
+        statusBar()->showMessage(tr("Preview"), 1000);
+    });
+    connect(previewWorker, &ProcessingWorker::jobFailed, this, [](quint64, const QString &message) {
+        qDebug() << "Preview failed:" << message;
+    });
+
+    refineTimer = new QTimer(this);
+    refineTimer->setSingleShot(true);
+    refineTimer->setInterval(PREVIEW_SETTLE_MS);
+    connect(refineTimer, &QTimer::timeout, this, [this]() {
+        std::function<void()> refine = std::move(pendingRefine);
+        pendingRefine = nullptr;
+        if (refine) {
+            refine();
+        }
+    });
+
     //hideControlElements();
 
 
@@ -53,6 +124,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    delete worker;  // Waits for the job in flight before the widgets go away
+    delete previewWorker;
     delete ui;
 
 }
@@ -150,16 +223,186 @@ void MainWindow::showMorphologicalControls()
 // --------------------------------------------------------------------------------------------------------------
 
 // Function to display image
-void MainWindow::updateImageDisplay(const ImageReadResult &image, QLabel *label)
+void MainWindow::updateImageDisplay(const ImageReadResult &image, QLabel *label, DisplayCache &cache,
+                                    const PointOpChain &pointOps)
 {
     if (!image.buffer) {
         qDebug() << "No image data to display.";
         return;
     }
 
-    QImage displayImage(image.buffer->data(), image.meta.width, image.meta.height, QImage::Format_Grayscale8);
-    QImage flippedImage = displayImage.mirrored(false, true); // Flip vertically
-    label->setPixmap(QPixmap::fromImage(flippedImage.scaled(label->size(), Qt::KeepAspectRatio)));
+    // Flipped and scaled once per image and label size; point operations only touch the scaled pixels
+    label->setPixmap(cache.render(image, label->size(), pointOps));
+}
+
+// Show the result image, with its deferred point operations
+void MainWindow::updateResultDisplay()
+{
+    updateImageDisplay(resultImage, ui->ResultWindowLabel, resultDisplay, resultPointOps);
+}
+
+// Store the current result for undo
+void MainWindow::saveUndoState()
+{
+    history.push(resultImage, resultPointOps);
+}
+
+// Apply the deferred point operations to the result pixels, before an operation that reads them
+void MainWindow::commitPointOps()
+{
+    resultPointOps.materialize(resultImage);
+}
+
+// Run `operation` on the result image in the background. While another job is in flight it
+// is queued and starts on that job's result.
+void MainWindow::runImageJob(const QString &name, ImageOperation operation)
+{
+    if (worker->isBusy()) {
+        queuedOperations.emplace_back(name, [this, name, operation]() { runImageJob(name, operation); });
+        statusBar()->showMessage(tr("%1 queued behind %2").arg(name, activeJobName), 3000);
+        return;
+    }
+
+    // A preview still running would draw over the result
+    previewWorker->cancel();
+    refineTimer->stop();
+    pendingRefine = nullptr;
+
+    // Shares the pixels, so the snapshot is free; it reaches the history once the job succeeds
+    jobSnapshot = resultImage;
+    jobSnapshotPointOps = resultPointOps;
+    commitPointOps();
+
+    ImageReadResult input = resultImage;
+    worker->submit(name, [input, operation]() {
+        ImageReadResult output;
+        operation(input, output);
+        return output;
+    });
+}
+
+// Add a point operation to the deferred chain, after the job in flight if there is one
+void MainWindow::runPointOp(const QString &name, PointOperation operation)
+{
+    if (worker->isBusy()) {
+        queuedOperations.emplace_back(name, [this, name, operation]() { runPointOp(name, operation); });
+        statusBar()->showMessage(tr("%1 queued behind %2").arg(name, activeJobName), 3000);
+        return;
+    }
+
+    previewWorker->cancel();
+    refineTimer->stop();
+    pendingRefine = nullptr;
+
+    saveUndoState();
+    operation(resultPointOps, resultImage.meta);
+    updateResultDisplay();
+}
+
+// Point operations run at once and image jobs start on the worker, which holds up the rest
+void MainWindow::runQueuedOperations()
+{
+    while (!queuedOperations.empty() && !worker->isBusy()) {
+        std::function<void()> next = std::move(queuedOperations.front().second);
+        queuedOperations.pop_front();
+        next();
+    }
+}
+
+void MainWindow::discardQueuedOperations(const QString &reason)
+{
+    if (queuedOperations.empty()) {
+        return;
+    }
+
+    QStringList names;
+    for (const auto &queued : queuedOperations) {
+        names << queued.first;
+    }
+    queuedOperations.clear();
+    statusBar()->showMessage(tr("%1; discarded queued operations: %2").arg(reason, names.join(QStringLiteral(", "))), 5000);
+}
+
+// Stop everything that could still change the result image or its display
+void MainWindow::cancelJobs()
+{
+    if (worker->isBusy()) {
+        worker->cancel();
+        resultImage = jobSnapshot;
+        resultPointOps = jobSnapshotPointOps;
+        statusBar()->showMessage(tr("%1 cancelled").arg(activeJobName), 3000);
+        discardQueuedOperations(tr("%1 cancelled").arg(activeJobName));
+    }
+    jobSnapshot = ImageReadResult();
+    jobSnapshotPointOps.clear();
+
+    previewWorker->cancel();
+    refineTimer->stop();
+    pendingRefine = nullptr;
+}
+
+void MainWindow::updateStatsLabel()
+{
+    std::vector<OperationStats> stats = instrumentationStats();
+    auto last = std::max_element(stats.begin(), stats.end(), [](const OperationStats &a, const OperationStats &b) {
+        return a.lastSequence < b.lastSequence;
+    });
+    if (last == stats.end()) {
+        return;
+    }
+
+    std::ostringstream table;
+    dumpInstrumentation(table);
+    statsLabel->setText(QString::fromStdString(formatOperationStats(*last)));
+    statsLabel->setToolTip(QStringLiteral("<pre>%1</pre>").arg(QString::fromStdString(table.str()).toHtmlEscaped()));
+}
+
+// Run `operation` on the pyramid level of the result that fits its label (or on the full image)
+// and draw what comes back. `refine`, if given, runs once the controls have been left alone for
+// PREVIEW_SETTLE_MS.
+void MainWindow::requestPreview(PreviewOperation operation, std::function<void()> refine, bool fullResolution)
+{
+    if (!resultImage.buffer || resultImage.meta.bitDepth != 8) {
+        return;
+    }
+
+    QSize size = ui->ResultWindowLabel->size();
+    const PyramidLevel &level = fullResolution
+                                    ? previewPyramid.levelFor(resultImage, resultImage.meta.width, resultImage.meta.height)
+                                    : previewPyramid.levelFor(resultImage, size.width(), size.height());
+
+    // The pending point operations are cheap to apply to the small level
+    ImageReadResult input = level.image;
+    PointOpChain pointOps = resultPointOps;
+    pointOps.materialize(input);
+
+    // Previews run the same backend calls on a reduced level; recording them would skew the
+    // statistics and could make a cancelled preview the last operation shown
+    int factor = level.factor;
+    previewWorker->submit(tr("Preview"), [input, operation, factor]() {
+        InstrumentationSuspension suspension;
+        ImageReadResult output;
+        operation(input, output, factor);
+        return output;
+    });
+
+    pendingRefine = std::move(refine);
+    if (pendingRefine) {
+        refineTimer->start();
+    } else {
+        refineTimer->stop();
+    }
+}
+
+// Show the result with extra point operations that are not committed yet
+void MainWindow::previewPointOps(const PointOpChain &pointOps)
+{
+    if (!resultImage.buffer) {
+        return;
+    }
+
+    previewWorker->cancel();
+    updateImageDisplay(resultImage, ui->ResultWindowLabel, resultDisplay, pointOps);
 }
 
 // Load Image
@@ -182,10 +425,13 @@ void MainWindow::on_actionLoad_Image_triggered()
         return;
     }
 
+    cancelJobs();
     resultImage = originalImage;
+    resultPointOps.clear();
+    history.clear();        // The states of the previous image do not apply to this one
 
     // Display the image in the original image QLabel
-    updateImageDisplay(originalImage, ui->OriginalWindowLabel);
+    updateImageDisplay(originalImage, ui->OriginalWindowLabel, originalDisplay);
 }
 
 // }
@@ -195,15 +441,15 @@ void MainWindow::on_actionLoad_Image_triggered()
 
 void MainWindow::on_UndoPushButton_clicked()
 {
-    if (!previousImage.buffer) {
+    if (!history.canUndo()) {
         QMessageBox::information(this, tr("Information"), tr("No previous state to undo to."));
         return;
     }
 
-    redoImage = resultImage;
-    resultImage = previousImage;
+    cancelJobs();
+    history.undo(resultImage, resultPointOps);
 
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    updateResultDisplay();
 
     QMessageBox::information(this, tr("Undo"), tr("Reverted to the previous state."));
 
@@ -213,15 +459,15 @@ void MainWindow::on_UndoPushButton_clicked()
 
 void MainWindow::on_RedoPushushButton_clicked()
 {
-    if (!redoImage.buffer) {
+    if (!history.canRedo()) {
         QMessageBox::information(this, tr("Information"), tr("No redo state available."));
         return;
     }
 
-    previousImage = resultImage;
-    resultImage = redoImage;
+    cancelJobs();
+    history.redo(resultImage, resultPointOps);
 
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    updateResultDisplay();
 
     QMessageBox::information(this, tr("Redo"), tr("Redone the previous undo action."));
 
@@ -238,17 +484,10 @@ void MainWindow::on_actionNegative_triggered() {
         return;
     }
 
-    previousImage = resultImage;
-
-    qDebug() << "Applying Negative Transformation...";
-
-    // Apply transformation
-    applyNegativeB(&resultImage);
-
-    qDebug() << "Negative Transformation Completed";
-
-    // Update the result window
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    // Deferred: composed with the other point operations and applied in one pass when needed
+    runPointOp(tr("Negative"), [](PointOpChain &pointOps, const ImageMetadata &meta) {
+        deferNegative(pointOps, meta);
+    });
 
 }
 
@@ -260,17 +499,11 @@ void MainWindow::on_actionLog_triggered() {
         return;
     }
 
-    previousImage = resultImage;
-
     double c = 255.0 / log(1 + 255.0);
 
-    qDebug() << "Applying Log Transformation...";
-
-    applyLogTransform(&resultImage, c);
-
-    qDebug() << "Log Transformation Completed";
-
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    runPointOp(tr("Log transform"), [c](PointOpChain &pointOps, const ImageMetadata &meta) {
+        deferLogTransform(pointOps, meta, c);
+    });
 
 
 }
@@ -286,18 +519,24 @@ void MainWindow::on_actionGamma_triggered() {
         return;
     }
 
-    previousImage = resultImage;
-
     double gammaValue = ui->GammaSlider->value() / 10.0;
 
-    qDebug() << "Applying Gamma Transformation...";
-
-    applyGammaTransform(&resultImage, 1.0, gammaValue);
+    runPointOp(tr("Gamma transform"), [gammaValue](PointOpChain &pointOps, const ImageMetadata &meta) {
+        deferGammaTransform(pointOps, meta, 1.0, gammaValue);
+    });
 
-    qDebug() << "Gamma Transformation Completed";
+}
 
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+// While dragging: show the gamma on the display only; it is committed when the slider is released
+void MainWindow::on_GammaSlider_valueChanged(int value)
+{
+    if (!resultImage.buffer) {
+        return;
+    }
 
+    PointOpChain preview = resultPointOps;
+    deferGammaTransform(preview, resultImage.meta, 1.0, value / 100.0);
+    previewPointOps(preview);
 }
 
 void MainWindow::on_GammaSlider_sliderReleased()
@@ -314,13 +553,10 @@ void MainWindow::on_GammaSlider_sliderReleased()
         return;
     }
 
-    previousImage = resultImage;
-
-    // Apply the gamma transformation directly to the image in the backend
-    qDebug() << "Applying gamma transformation";
-    applyGammaTransform(&resultImage, 1.0, gammaValue);
-
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    // Add the gamma transformation to the deferred point operations
+    runPointOp(tr("Gamma transform"), [gammaValue](PointOpChain &pointOps, const ImageMetadata &meta) {
+        deferGammaTransform(pointOps, meta, 1.0, gammaValue);
+    });
 
 }
 
@@ -339,6 +575,9 @@ void MainWindow::on_kernelSizeSlider_valueChanged(int value)
     ui->kernelSizeSpinBox->blockSignals(false);
 
     qDebug() << "Slider value changed to:" << value;
+
+    // Low resolution preview while dragging; the release applies the filter
+    previewFilter(activeFilter, false);
 }
 
 void MainWindow::on_kernelSizeSlider_sliderReleased()
@@ -356,9 +595,8 @@ void MainWindow::on_kernelSizeSpinBox_valueChanged(int value)
     }
     ui->kernelSizeSlider->setValue(value);
 
-    qDebug() << "Applying filter using spin box value";
-
-    applyFilter(activeFilter);
+    // Preview at once, and apply once the spin box has been left alone for a moment
+    previewFilter(activeFilter, true);
 
 }
 
@@ -377,30 +615,48 @@ void MainWindow::applyFilter(FilterType filterType)
         return;
     }
 
-    previousImage = resultImage;
-
     int kernelSize = ui->kernelSizeSpinBox->value();
     qDebug() << "Applying filter with kernel size:" << kernelSize;
 
-    try {
+    // Moving the kernel slider again supersedes the run still in flight
+    switch (filterType) {
+    case Box:
+        runImageJob(tr("Box filter"), [kernelSize](const ImageReadResult &input, ImageReadResult &output) {
+            boxFilter(input, output, kernelSize);
+        });
+        break;
+    case Gaussian:
+        runImageJob(tr("Gaussian filter"), [kernelSize](const ImageReadResult &input, ImageReadResult &output) {
+            gaussianFilter(input, output, kernelSize, 1.0);
+        });
+        break;
+    case Median:
+        runImageJob(tr("Median filter"), [kernelSize](const ImageReadResult &input, ImageReadResult &output) {
+            medianFilter(input, output, kernelSize);
+        });
+        break;
+    }
+}
+
+// Preview the low-pass filter at screen resolution; with `apply`, run it for real once input settles
+void MainWindow::previewFilter(FilterType filterType, bool apply)
+{
+    int kernelSize = ui->kernelSizeSpinBox->value();
+
+    requestPreview([filterType, kernelSize](const ImageReadResult &input, ImageReadResult &output, int factor) {
+        int size = scaleKernelSize(kernelSize, factor);
         switch (filterType) {
         case Box:
-            boxFilter(previousImage, resultImage, kernelSize);
+            boxFilter(input, output, size);
             break;
         case Gaussian:
-            gaussianFilter(previousImage, resultImage, kernelSize, 1.0);
+            gaussianFilter(input, output, size, 1.0 / factor);
             break;
         case Median:
-            medianFilter(previousImage, resultImage, kernelSize);
+            medianFilter(input, output, size);
             break;
         }
-    } catch (const std::exception &e) {
-        QMessageBox::critical(this, tr("Error"), tr("Filter failed: %1").arg(e.what()));
-        return;
-    }
-
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-
+    }, apply ? std::function<void()>([this, filterType]() { applyFilter(filterType); }) : nullptr);
 }
 
 void MainWindow::on_actionBox_Filter_triggered()
@@ -441,10 +697,9 @@ void MainWindow::on_actionBasic_Laplacian_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying highpass filter with Basic Laplacian";
-    previousImage = resultImage;
-    highpassFilter(previousImage, resultImage, 1);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Highpass filter with Basic Laplacian completed";
+    runImageJob(tr("Highpass filter"), [](const ImageReadResult &input, ImageReadResult &output) {
+        highpassFilter(input, output, 1);
+    });
 }
 
 
@@ -452,10 +707,9 @@ void MainWindow::on_actionFull_Laplacian_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying highpass filter with Full Laplacian";
-    previousImage = resultImage;
-    highpassFilter(previousImage, resultImage, 2);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Highpass filter with Full Laplacian completed";
+    runImageJob(tr("Highpass filter"), [](const ImageReadResult &input, ImageReadResult &output) {
+        highpassFilter(input, output, 2);
+    });
 }
 
 
@@ -463,10 +717,9 @@ void MainWindow::on_actionBasic_Inverted_Laplacian_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying highpass filter with Basic Inverted Laplacian";
-    previousImage = resultImage;
-    highpassFilter(previousImage, resultImage, 3);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Highpass filter with Basic Inverted Laplacian completed";
+    runImageJob(tr("Highpass filter"), [](const ImageReadResult &input, ImageReadResult &output) {
+        highpassFilter(input, output, 3);
+    });
 }
 
 
@@ -474,10 +727,9 @@ void MainWindow::on_actionFull_Inverted_Laplacian_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying highpass filter with Full Inverted Laplacian";
-    previousImage = resultImage;
-    highpassFilter(previousImage, resultImage, 4);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Highpass filter with Full Inverted Laplacian completed";
+    runImageJob(tr("Highpass filter"), [](const ImageReadResult &input, ImageReadResult &output) {
+        highpassFilter(input, output, 4);
+    });
 }
 
 
@@ -485,10 +737,9 @@ void MainWindow::on_actionSobel_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying highpass filter with Sobel Operator";
-    previousImage = resultImage;
-    highpassFilter(previousImage, resultImage, 5);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Highpass filter with Sobel completed";
+    runImageJob(tr("Highpass filter"), [](const ImageReadResult &input, ImageReadResult &output) {
+        highpassFilter(input, output, 5);
+    });
 }
 
 // }
@@ -500,10 +751,9 @@ void MainWindow::on_actionBasic_Laplacian_2_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying image sharpening with basic laplacian highpass filter";
-    previousImage = resultImage;
-    imageSharpening(previousImage, resultImage, 1);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Completed image sharpening with basic laplacian highpass filter";
+    runImageJob(tr("Image sharpening"), [](const ImageReadResult &input, ImageReadResult &output) {
+        imageSharpening(input, output, 1);
+    });
 }
 
 
@@ -511,10 +761,9 @@ void MainWindow::on_actionFull_Laplacian_2_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying image sharpening with full laplacian highpass filter";
-    previousImage = resultImage;
-    imageSharpening(previousImage, resultImage, 2);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Completed image sharpening with full laplacian highpass filter";
+    runImageJob(tr("Image sharpening"), [](const ImageReadResult &input, ImageReadResult &output) {
+        imageSharpening(input, output, 2);
+    });
 }
 
 
@@ -522,10 +771,9 @@ void MainWindow::on_actionBaisc_Inverted_Laplacian_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying image sharpening with basic inverted laplacian highpass filter";
-    previousImage = resultImage;
-    imageSharpening(previousImage, resultImage, 3);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Completed image sharpening with basic inverted laplacian highpass filter";
+    runImageJob(tr("Image sharpening"), [](const ImageReadResult &input, ImageReadResult &output) {
+        imageSharpening(input, output, 3);
+    });
 }
 
 
@@ -533,10 +781,9 @@ void MainWindow::on_actionFull_Inverted_Laplacian_2_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying image sharpening with full inverted laplacian highpass filter";
-    previousImage = resultImage;
-    imageSharpening(previousImage, resultImage, 4);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Completed image sharpening with full inverted laplacian highpass filter";
+    runImageJob(tr("Image sharpening"), [](const ImageReadResult &input, ImageReadResult &output) {
+        imageSharpening(input, output, 4);
+    });
 }
 
 
@@ -544,10 +791,9 @@ void MainWindow::on_actionSobel_2_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying image sharpening with soble highpass filter";
-    previousImage = resultImage;
-    imageSharpening(previousImage, resultImage, 5);
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Completed image sharpening with sobel highpass filter";
+    runImageJob(tr("Image sharpening"), [](const ImageReadResult &input, ImageReadResult &output) {
+        imageSharpening(input, output, 5);
+    });
 }
 
 // }
@@ -558,11 +804,12 @@ void MainWindow::on_actionUnsharp_Maksing_Highboost_Filtering_triggered()
 {
     //hideControlElements();
     qDebug() << "Applying Unsharp Masking";
-    previousImage = resultImage;
+    commitPointOps();
+    saveUndoState();
 
 
 
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    updateResultDisplay();
     qDebug() << "Completed Unsharp Masking";
 }
 
@@ -585,6 +832,7 @@ void MainWindow::on_ThresholdSlider_valueChanged(int value) {
     ui->ThresholdSpinBox->blockSignals(true);
     ui->ThresholdSpinBox->setValue(value); // Sync with spinbox
     ui->ThresholdSpinBox->blockSignals(false);
+    previewThreshold(value);
 }
 
 // Slot for spinbox value change
@@ -592,6 +840,14 @@ void MainWindow::on_ThresholdSpinBox_valueChanged(int value) {
     ui->ThresholdSlider->blockSignals(true);
     ui->ThresholdSlider->setValue(value); // Sync with slider
     ui->ThresholdSlider->blockSignals(false);
+    previewThreshold(value);
+}
+
+// Show the threshold on the display only; the Convert button commits it
+void MainWindow::previewThreshold(int threshold) {
+    PointOpChain preview = resultPointOps;
+    deferGrayscaleToBinary(preview, threshold);
+    previewPointOps(preview);
 }
 
 // Slot for Convert button click
@@ -603,13 +859,10 @@ void MainWindow::on_ImageConverterPushButton_clicked() {
 
     int threshold = ui->ThresholdSpinBox->value(); // Get threshold value
 
-    previousImage = resultImage; // store the current result image as previous image
-
-    // Apply grayscale to binary conversion using your algorithm
-    grayscaleToBinary(previousImage, resultImage, threshold);
-
-    // Update the Result Image display
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    // Grayscale to binary is a point operation too, so it is deferred like the others
+    runPointOp(tr("Grayscale to binary"), [threshold](PointOpChain &pointOps, const ImageMetadata &) {
+        deferGrayscaleToBinary(pointOps, threshold);
+    });
     qDebug() << "Completed conversion from grayscale to binary";
 }
 
@@ -672,6 +925,7 @@ void MainWindow::on_mKernelSlider_valueChanged(int value)
     ui->mkernelSpinBox->blockSignals(true);
     ui->mkernelSpinBox->setValue(value);
     ui->mkernelSpinBox->blockSignals(false);
+    previewMorphology(false);
 }
 
 
@@ -680,6 +934,7 @@ void MainWindow::on_mkernelSpinBox_valueChanged(int value)
     ui->mKernelSlider->blockSignals(true);
     ui->mKernelSlider->setValue(value);
     ui->mKernelSlider->blockSignals(false);
+    previewMorphology(false);
 }
 
 
@@ -688,6 +943,7 @@ void MainWindow::on_mKernelSlider_2_valueChanged(int value)
     ui->mKernelSpinBox2->blockSignals(true);
     ui->mKernelSpinBox2->setValue(value);
     ui->mKernelSpinBox2->blockSignals(false);
+    previewMorphology(false);
 }
 
 
@@ -696,9 +952,31 @@ void MainWindow::on_mKernelSpinBox2_valueChanged(int value)
     ui->mKernelSlider_2->blockSignals(true);
     ui->mKernelSlider_2->setValue(value);
     ui->mKernelSlider_2->blockSignals(false);
+    previewMorphology(false);
 }
 
 
+// Preview the selected operation at screen resolution, then at full resolution once the kernel
+// controls settle. Nothing is committed until Apply.
+void MainWindow::previewMorphology(bool fullResolution)
+{
+    int kernelRows = ui->mkernelSpinBox->value();
+    int kernelColumns = ui->mKernelSpinBox2->value();
+    MorphologicalOperation operation = currentMorphologicalOperation;
+
+    requestPreview([operation, kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output, int factor) {
+        int columns = scaleKernelSize(kernelColumns, factor);
+        int rows = scaleKernelSize(kernelRows, factor);
+        switch (operation) {
+            case MorphologicalOperation::Erosion:            erosion(input, output, columns, rows);            break;
+            case MorphologicalOperation::Dilation:           dilation(input, output, columns, rows);           break;
+            case MorphologicalOperation::Opening:            opening(input, output, columns, rows);            break;
+            case MorphologicalOperation::Closing:            closing(input, output, columns, rows);            break;
+            case MorphologicalOperation::BoundaryExtraction: boundaryExtraction(input, output, columns, rows); break;
+        }
+    }, fullResolution ? nullptr : std::function<void()>([this]() { previewMorphology(true); }), fullResolution);
+}
+
 void MainWindow::on_applyPushButton_clicked()
 {
     if (!resultImage.buffer) {
@@ -709,35 +987,40 @@ void MainWindow::on_applyPushButton_clicked()
     int kernelRows = ui->mkernelSpinBox->value();
     int kernelColumns = ui->mKernelSpinBox2->value();
 
-    previousImage = resultImage; // store the current result image as previous image
-
     switch (currentMorphologicalOperation) {
         case MorphologicalOperation::Erosion:
             qDebug() << "Applying Erosion...";
-            erosion(previousImage, resultImage, kernelColumns, kernelRows);
+            runImageJob(tr("Erosion"), [kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output) {
+                erosion(input, output, kernelColumns, kernelRows);
+            });
             break;
         case MorphologicalOperation::Dilation:
             qDebug() << "Applying Dilation...";
-            dilation(previousImage, resultImage, kernelColumns, kernelRows);
+            runImageJob(tr("Dilation"), [kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output) {
+                dilation(input, output, kernelColumns, kernelRows);
+            });
             break;
         case MorphologicalOperation::Opening:
             qDebug() << "Applying Opening...";
-            opening(previousImage, resultImage, kernelColumns, kernelRows);
+            runImageJob(tr("Opening"), [kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output) {
+                opening(input, output, kernelColumns, kernelRows);
+            });
             break;
         case MorphologicalOperation::Closing:
             qDebug() << "Applying Closing...";
-            closing(previousImage, resultImage, kernelColumns, kernelRows);
+            runImageJob(tr("Closing"), [kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output) {
+                closing(input, output, kernelColumns, kernelRows);
+            });
             break;
         case MorphologicalOperation::BoundaryExtraction:
             qDebug() << "Applying Boundary Extraction...";
-            boundaryExtraction(previousImage, resultImage, kernelColumns, kernelRows);
+            runImageJob(tr("Boundary extraction"), [kernelColumns, kernelRows](const ImageReadResult &input, ImageReadResult &output) {
+                boundaryExtraction(input, output, kernelColumns, kernelRows);
+            });
             break;
         default:
             break;
     }
-
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Operation completed.";
 }
 
 
@@ -792,17 +1075,11 @@ void MainWindow::on_applyPushButton_2_clicked()
         return;
     }
 
-    // 4. Store the current state for undo
-    previousImage = resultImage;
-
-    // 5. Apply edge detection
-
-    gradientEdgeDetection(previousImage, resultImage, kernelChoice, paddingChoice, applyThreshold, thresholdValue);
-
-    // 6. Update the result display
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Operation completed.";
-
+    // 4. Apply edge detection in the background; the result display updates when it finishes
+    runImageJob(tr("Gradient edge detection"),
+                [kernelChoice, paddingChoice, applyThreshold, thresholdValue](const ImageReadResult &input, ImageReadResult &output) {
+        gradientEdgeDetection(input, output, kernelChoice, paddingChoice, applyThreshold, thresholdValue);
+    });
 }
 
 
@@ -839,35 +1116,36 @@ void MainWindow::on_applyPB_clicked()
 
     double kernelSize = ui->kernelSpinBox->value();
     double sigma = ui->sigmaDoubleSpinBox->value();
-    previousImage = resultImage;
-
-    if(ui->gaussianRadioButton->isChecked()) {
-        qDebug() << "Applying Gaussian filter...";
-        gaussianFilter(previousImage, resultImage, kernelSize, sigma);
-        qDebug() << "Gaussian Filter Applied with Kernel Size: " << kernelSize << "and sigma: " << sigma;
-    }
+    bool smooth = ui->gaussianRadioButton->isChecked();
 
+    int laplacianKernel = 0;
     if (ui->basicLaplacianRadioButton->isChecked()) {
-        qDebug() << "Applying Basic Laplacian...";
-        highpassFilter(previousImage, resultImage, 1);
-        qDebug() << "Basic Laplacian Applied";
+        laplacianKernel = 1;
     } else if (ui->fullLaplacianRadioButton->isChecked()) {
-        qDebug() << "Applying Full Laplacian...";
-        highpassFilter(previousImage, resultImage, 2);
-        qDebug() << "Full Laplacian Applied";
+        laplacianKernel = 2;
     } else if (ui->basicInvertedLaplacianRadioButton->isChecked()) {
-        qDebug() << "Applying Basic Inverted Laplacian...";
-        highpassFilter(previousImage, resultImage, 3);
-        qDebug() << "Basic Inverted Laplacian Applied";
+        laplacianKernel = 3;
     } else if (ui->fullInvertedLaplacianRadioButton->isChecked()) {
-        qDebug() << "Applying Full Inverted Laplacian...";
-        highpassFilter(previousImage, resultImage, 4);
-        qDebug() << "Full Inverted Laplacian Applied";
+        laplacianKernel = 4;
     }
 
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
-    qDebug() << "Operation completed.";
+    qDebug() << "Applying Laplacian" << laplacianKernel << "with Gaussian:" << smooth
+             << "kernel size:" << kernelSize << "sigma:" << sigma;
 
+    // Like before, the Laplacian reads the unsmoothed input and replaces the Gaussian result
+    runImageJob(tr("Laplacian"), [smooth, kernelSize, sigma, laplacianKernel](const ImageReadResult &input, ImageReadResult &output) {
+        if (smooth) {
+            ProgressStage stage(0, laplacianKernel ? 2 : 1);
+            gaussianFilter(input, output, kernelSize, sigma);
+        }
+        if (laplacianKernel) {
+            ProgressStage stage(smooth ? 1 : 0, smooth ? 2 : 1);
+            highpassFilter(input, output, laplacianKernel);
+        }
+        if (!smooth && !laplacianKernel) {
+            output = input;
+        }
+    });
 }
 
 
@@ -924,12 +1202,10 @@ void MainWindow::on_applyPBCanny_clicked()
         return;
     }
 
-    // Store current image for undo
-    previousImage = resultImage;
-
     qDebug() << "Performing Canny Edge Detection...";
-    cannyEdgeDetection(previousImage, resultImage, lowThreshold, highThreshold, kernelSize, sigma, paddingChoice);
-    qDebug() << "Canny Edge Detection Completed";
-    updateImageDisplay(resultImage, ui->ResultWindowLabel);
+    runImageJob(tr("Canny edge detection"),
+                [lowThreshold, highThreshold, kernelSize, sigma, paddingChoice](const ImageReadResult &input, ImageReadResult &output) {
+        cannyEdgeDetection(input, output, lowThreshold, highThreshold, kernelSize, sigma, paddingChoice);
+    });
 }
 
@@ -5,10 +5,20 @@
 #include <QString>
 #include <QImage>
 #include <QLabel>
+#include <QTimer>
+#include <QTemporaryDir>
+
+#include <deque>
+#include <functional>
+#include <utility>
 
 #include "imageprocessingbackend.h"
+#include "processingworker.h"
+#include "displaycache.h"
+#include "ImagePyramid.h"
 #include "ImageFilter.h"
 #include "ImageUtils.h"
+#include "UndoHistory.h"
 
 enum FilterType { Box, Gaussian, Median };
 enum KernelType {BasicLaplacian, FullLaplacian, BasicInvertedLaplacian, FullInvertedLaplacian};
@@ -33,6 +43,7 @@ private slots:
     void on_actionNegative_triggered();
     void on_actionLog_triggered();
     void on_actionGamma_triggered();
+    void on_GammaSlider_valueChanged(int value);
     void on_GammaSlider_sliderReleased();
 
 
@@ -144,14 +155,65 @@ private:
    // QImage originalImage;   // To store the original image
     QByteArray originalImageToRawData(const QImage &image);
     QImage rawDataToQImage(const QByteArray &data, int width, int height, QImage::Format format);
+    // Copies share their pixels until one of them is written (see PixelBuffer), so taking
+    // snapshots of the result costs nothing until it changes
     ImageReadResult originalImage;
     ImageReadResult resultImage;
-    ImageReadResult previousImage;
-    ImageReadResult redoImage;
+
+    // Point operations not yet applied to the pixels of resultImage
+    PointOpChain resultPointOps;
+
+    // Directory of this process's own for the states the history spills, removed with the window;
+    // declared first so the history, which removes its files, is destroyed before it
+    QTemporaryDir undoSpillDirectory;
+
+    // Earlier and undone states of resultImage, delta coded
+    UndoHistory history;
+    void saveUndoState();                // Store the result image and its point operations for undo
+    void commitPointOps();               // Apply the pending point operations to resultImage
 
     FilterType activeFilter = FilterType::Box; // Declare activeFilter here
     void applyFilter(FilterType filterType);
-    void updateImageDisplay(const ImageReadResult &image, QLabel *label);
+    void updateImageDisplay(const ImageReadResult &image, QLabel *label, DisplayCache &cache,
+                            const PointOpChain &pointOps = PointOpChain());
+    void updateResultDisplay();
+    DisplayCache originalDisplay;
+    DisplayCache resultDisplay;
+
+    // Neighbourhood operations run on the worker; the result replaces resultImage when they finish.
+    // The state before the job goes into the history only then, so a failed or cancelled job
+    // leaves no undo entry. Operations asked for while a job runs wait in a queue.
+    using ImageOperation = std::function<void(const ImageReadResult &, ImageReadResult &)>;
+    using PointOperation = std::function<void(PointOpChain &, const ImageMetadata &)>;
+    ProcessingWorker *worker;
+    QString activeJobName;
+    ImageReadResult jobSnapshot;         // resultImage and its point operations when the job started
+    PointOpChain jobSnapshotPointOps;
+    std::deque<std::pair<QString, std::function<void()>>> queuedOperations;
+    void runImageJob(const QString &name, ImageOperation operation);
+    void runPointOp(const QString &name, PointOperation operation);
+    void runQueuedOperations();          // Start what was queued behind the finished job
+    void discardQueuedOperations(const QString &reason);
+    void cancelJobs();                   // Cancel the job, its queue and any preview in flight
+
+    // Timing of the last backend operation, with every operation's counters in its tooltip
+    QLabel *statsLabel;
+    void updateStatsLabel();
+
+    // Live previews while a control is dragged. They run on the pyramid level of the result that
+    // fits the label, `factor` times smaller than the result, and are only drawn, never committed.
+    using PreviewOperation = std::function<void(const ImageReadResult &, ImageReadResult &, int factor)>;
+    static constexpr int PREVIEW_SETTLE_MS = 300;   // Quiet time before a preview is refined
+    ProcessingWorker *previewWorker;
+    QTimer *refineTimer;
+    std::function<void()> pendingRefine;
+    ImagePyramid previewPyramid;
+    DisplayCache previewDisplay;
+    void requestPreview(PreviewOperation operation, std::function<void()> refine = nullptr, bool fullResolution = false);
+    void previewPointOps(const PointOpChain &pointOps);
+    void previewFilter(FilterType filterType, bool apply);
+    void previewThreshold(int threshold);
+    void previewMorphology(bool fullResolution);
 
     MorphologicalOperation currentMorphologicalOperation;
 
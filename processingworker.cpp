@@ -0,0 +1,98 @@
+#include "processingworker.h"
+
+#include <QMetaObject>
+#include <QRunnable>
+
+namespace {
+
+// Runs a callable on a pool thread (QThreadPool::start(std::function) needs Qt 5.15)
+class FunctionRunnable : public QRunnable
+{
+public:
+    explicit FunctionRunnable(std::function<void()> function) : function(std::move(function)) {}
+    void run() override { function(); }
+
+private:
+    std::function<void()> function;
+};
+
+}
+
+ProcessingWorker::ProcessingWorker(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<ImageReadResult>("ImageReadResult");
+
+    // Superseded jobs stop at their next row, so two threads are enough to start the new one at once
+    pool.setMaxThreadCount(2);
+}
+
+ProcessingWorker::~ProcessingWorker()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+quint64 ProcessingWorker::submit(const QString &name, Job job)
+{
+    cancel();
+
+    quint64 jobId = ++lastJobId;
+    auto context = std::make_shared<ProcessingContext>();
+    activeContext = context;
+    activeJobId = jobId;
+
+    // Everything the pool thread hands back is queued onto this object's thread. The destructor
+    // waits for the pool, so `this` outlives the job, and Qt drops calls still queued after that.
+    // The id checks drop whatever a superseded job delivers.
+    auto post = [this](std::function<void(ProcessingWorker *)> deliver) {
+        QMetaObject::invokeMethod(this, [this, deliver]() { deliver(this); }, Qt::QueuedConnection);
+    };
+
+    context->onProgress = [post, jobId](int percent) {
+        post([jobId, percent](ProcessingWorker *worker) {
+            if (worker->activeJobId == jobId) {
+                emit worker->progressChanged(jobId, percent);
+            }
+        });
+    };
+
+    emit jobStarted(jobId, name);
+
+    pool.start(new FunctionRunnable([context, job = std::move(job), post, jobId]() {
+        ProcessingScope scope(context.get());
+        try {
+            ImageReadResult result = job();
+            throwIfCancelled();
+            post([jobId, result = std::move(result)](ProcessingWorker *worker) {
+                if (worker->activeJobId == jobId) {
+                    worker->activeJobId = 0;
+                    emit worker->jobFinished(jobId, result);
+                }
+            });
+        } catch (const OperationCancelled &) {
+            post([jobId](ProcessingWorker *worker) {
+                emit worker->jobCancelled(jobId);
+            });
+        } catch (const std::exception &e) {
+            QString message = QString::fromStdString(e.what());
+            post([jobId, message](ProcessingWorker *worker) {
+                if (worker->activeJobId == jobId) {
+                    worker->activeJobId = 0;
+                    emit worker->jobFailed(jobId, message);
+                }
+            });
+        }
+    }));
+
+    return jobId;
+}
+
+void ProcessingWorker::cancel()
+{
+    if (activeContext) {
+        activeContext->cancel();
+        activeContext.reset();
+    }
+    activeJobId = 0;
+}
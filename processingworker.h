@@ -0,0 +1,58 @@
+#ifndef PROCESSINGWORKER_H
+#define PROCESSINGWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QMetaType>
+
+#include <functional>
+#include <memory>
+
+#include "ImageIO.h"
+#include "ProcessingControl.h"
+
+Q_DECLARE_METATYPE(ImageReadResult)
+
+/**
+ * @brief Runs image jobs off the GUI thread, one at a time.
+ *
+ * submit() starts a job on a pool thread and cancels the job that was running, so only
+ * the most recent request ever produces a result. Progress and results come back as
+ * signals delivered on the thread the worker lives on (the GUI thread), tagged with the
+ * id submit() returned.
+ */
+class ProcessingWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Runs on a pool thread; may throw, and stops early with OperationCancelled
+    using Job = std::function<ImageReadResult()>;
+
+    explicit ProcessingWorker(QObject *parent = nullptr);
+    ~ProcessingWorker();
+
+    // Starts `job`, superseding the one in flight; returns the id used in the signals
+    quint64 submit(const QString &name, Job job);
+
+    // Cancels the job in flight, if any; it reports jobCancelled instead of a result
+    void cancel();
+
+    bool isBusy() const { return activeJobId != 0; }
+
+signals:
+    void jobStarted(quint64 jobId, const QString &name);
+    void progressChanged(quint64 jobId, int percent);
+    void jobFinished(quint64 jobId, const ImageReadResult &result);
+    void jobFailed(quint64 jobId, const QString &message);
+    void jobCancelled(quint64 jobId);
+
+private:
+    QThreadPool pool;
+    std::shared_ptr<ProcessingContext> activeContext;   // Context of the job in flight
+    quint64 activeJobId = 0;                             // 0 when idle
+    quint64 lastJobId = 0;
+};
+
+#endif // PROCESSINGWORKER_H